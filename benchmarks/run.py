@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""Runtime benchmark runner for the programs in benchmarks/.
+
+Every program is compiled with each available backend and profile, run
+several times, and its median runtime and binary size are compared
+against the checked-in baseline. The script exits with a non zero status
+when a program fails to build or run, or when a regression exceeds the
+configured threshold.
+"""
+
+import argparse
+import json
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BENCH_DIR = os.path.join(ROOT, "benchmarks")
+
+KNOWN_BACKENDS = ["g++", "clang++"]
+PROFILES = ["debug", "release"]
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--cern", default=os.path.join(ROOT, "build", "cern"),
+                        help="path to the compiler (default build/cern)")
+    parser.add_argument("--baseline", default=os.path.join(BENCH_DIR, "baseline.json"),
+                        help="baseline file (default benchmarks/baseline.json)")
+    parser.add_argument("--runs", type=int, default=5,
+                        help="runs of each program, the median is kept (default 5)")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="allowed runtime regression, 0.10 is 10%% (default 0.10)")
+    parser.add_argument("--size-threshold", type=float, default=0.05,
+                        help="allowed binary size regression (default 0.05)")
+    parser.add_argument("--backends", default=None,
+                        help="comma separated backends (default: every installed one of %s)" % ",".join(KNOWN_BACKENDS))
+    parser.add_argument("--profiles", default=",".join(PROFILES),
+                        help="comma separated profiles (default debug,release)")
+    parser.add_argument("--filter", default="",
+                        help="only run programs whose name contains this string")
+    parser.add_argument("--update-baseline", action="store_true",
+                        help="write the measured results to the baseline file instead of comparing")
+    return parser.parse_args()
+
+
+def available_backends(requested):
+    if requested:
+        return [b for b in requested.split(",") if b]
+    return [b for b in KNOWN_BACKENDS if shutil.which(b)]
+
+
+def programs(name_filter):
+    return sorted(f[:-3] for f in os.listdir(BENCH_DIR)
+                  if f.endswith(".ce") and name_filter in f)
+
+
+class BenchmarkError(Exception):
+    """a benchmark that did not build or did not run, reported on its own line"""
+
+
+def first_error(output):
+    for line in output.splitlines():
+        if "rror" in line:
+            return line.strip()
+    lines = output.strip().splitlines()
+    return lines[-1].strip() if lines else "no output"
+
+
+def build(cern, source, backend, profile, workdir):
+    exe = os.path.join(workdir, "bench")
+    cmd = [cern, "--backend=" + backend, "--profile=" + profile, "-o", exe, source]
+    result = subprocess.run(cmd, cwd=workdir, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    if result.returncode != 0 or not os.path.exists(exe):
+        raise BenchmarkError("BUILD FAILED: " + first_error(result.stdout))
+    return exe
+
+
+def measure(exe, runs):
+    times = []
+    for _ in range(runs):
+        start = time.perf_counter()
+        result = subprocess.run([exe], stdout=subprocess.DEVNULL)
+        if result.returncode != 0:
+            raise BenchmarkError("RUN FAILED: exit code %d" % result.returncode)
+        times.append((time.perf_counter() - start) * 1000.0)
+    return statistics.median(times)
+
+
+def main():
+    args = parse_args()
+
+    if not os.path.exists(args.cern):
+        print("compiler not found at %s, run `make` first" % args.cern, file=sys.stderr)
+        return 2
+
+    backends = available_backends(args.backends)
+    profiles = [p for p in args.profiles.split(",") if p]
+    if not backends:
+        print("no c++ backend available", file=sys.stderr)
+        return 2
+
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    results = {}
+    regressions = []
+    failures = []
+
+    print("%-32s %12s %12s %12s %12s" % ("benchmark", "median ms", "base ms", "size", "base size"))
+
+    for name in programs(args.filter):
+        source = os.path.join(BENCH_DIR, name + ".ce")
+        for backend in backends:
+            for profile in profiles:
+                key = "%s/%s/%s" % (name, backend, profile)
+
+                try:
+                    with tempfile.TemporaryDirectory() as workdir:
+                        exe = build(args.cern, source, backend, profile, workdir)
+                        size = os.path.getsize(exe)
+                        median = measure(exe, args.runs)
+                except BenchmarkError as e:
+                    failures.append(key)
+                    print("%-32s %s" % (key, e))
+                    continue
+
+                results[key] = {"median_ms": round(median, 3), "size": size}
+
+                base = baseline.get(key)
+                status = ""
+                if base is None:
+                    status = "new"
+                else:
+                    if median > base["median_ms"] * (1.0 + args.threshold):
+                        status = "SLOWER"
+                    if size > base["size"] * (1.0 + args.size_threshold):
+                        status = (status + " BIGGER").strip()
+                    if status:
+                        regressions.append(key)
+
+                print("%-32s %12.2f %12s %12d %12s %s" % (
+                    key, median,
+                    "-" if base is None else "%.2f" % base["median_ms"],
+                    size,
+                    "-" if base is None else str(base["size"]),
+                    status))
+
+    if failures:
+        print("\n%d benchmark(s) failed:" % len(failures))
+        for key in failures:
+            print("  " + key)
+        return 1
+
+    if args.update_baseline:
+        baseline.update(results)
+        with open(args.baseline, "w") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("baseline written to %s" % args.baseline)
+        return 0
+
+    if regressions:
+        print("\n%d regression(s) above the threshold:" % len(regressions))
+        for key in regressions:
+            print("  " + key)
+        return 1
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
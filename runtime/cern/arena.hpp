@@ -0,0 +1,164 @@
+#pragma once
+
+// runtime support of cern's `frame { ... }`: a bump allocator, in the style of the compiler's own
+// ArenaAllocator, that the lists declared inside a frame take their memory from
+//
+// an allocation moves an offset forward in the current chunk, freeing is a no-op, and the end of a
+// frame moves the offset back to where the frame began, whatever was allocated in between. a full
+// chunk is followed by a bigger one; chunks are kept after a frame ends, so once the arena has
+// grown to the largest frame the frames run without touching the heap
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace cern {
+    class arena {
+    private:
+        struct chunk {
+            std::byte* data;
+            std::size_t size;
+        };
+
+        std::vector<chunk> _chunks;
+        // chunk being filled and offset in it
+        std::size_t _current = 0;
+        std::size_t _offset = 0;
+
+        // bytes handed out (alignment padding included), and where the innermost frame began
+        std::size_t _used = 0;
+        std::size_t _frame_start = 0;
+        std::size_t _peak = 0;
+
+        // number of frames open
+        std::size_t _depth = 0;
+
+        // first chunk in bytes, each new chunk is twice as big as the previous one
+        static constexpr std::size_t first_chunk = 64 * 1024;
+
+        // move to the next chunk, replacing it if it cannot hold `bytes` (it holds nothing yet)
+        void next_chunk(std::size_t bytes, std::size_t align) {
+            std::size_t size = _chunks.empty() ? first_chunk : 2 * _chunks.back().size;
+            if (size < bytes + align)
+                size = bytes + align;
+
+            if (!_chunks.empty())
+                _current++;
+
+            if (_current == _chunks.size()) {
+                _chunks.push_back({ new std::byte[size], size });
+            }
+            else if (_chunks[_current].size < bytes + align) {
+                delete[] _chunks[_current].data;
+                _chunks[_current] = { new std::byte[size], size };
+            }
+
+            _offset = 0;
+        }
+
+    public:
+        // state of the arena when a frame begins, restored when it ends
+        struct mark {
+            std::size_t current;
+            std::size_t offset;
+            std::size_t used;
+            std::size_t frame_start;
+            std::size_t depth;
+        };
+
+        arena() = default;
+
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        ~arena() {
+            for (const chunk& c : _chunks)
+                delete[] c.data;
+        }
+
+        void* allocate(std::size_t bytes, std::size_t align) {
+            while (true) {
+                if (!_chunks.empty()) {
+                    chunk& c = _chunks[_current];
+                    void* p = c.data + _offset;
+                    std::size_t space = c.size - _offset;
+
+                    if (std::align(align, bytes, p, space) != nullptr) {
+                        const std::size_t end = static_cast<std::size_t>(static_cast<std::byte*>(p) - c.data) + bytes;
+                        _used += end - _offset;
+                        _offset = end;
+                        if (_used > _peak)
+                            _peak = _used;
+                        return p;
+                    }
+
+                    // what is left of the chunk is lost until the frame ends
+                    _used += c.size - _offset;
+                }
+
+                next_chunk(bytes, align);
+            }
+        }
+
+        template <typename T>
+        T* allocate(std::size_t n) {
+            return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+        }
+
+        mark begin_frame() {
+            const mark m{ _current, _offset, _used, _frame_start, _depth };
+            _frame_start = _used;
+            _depth++;
+            return m;
+        }
+
+        // O(1): everything allocated since `m` is released at once
+        void end_frame(const mark& m) {
+            _current = m.current;
+            _offset = m.offset;
+            _used = m.used;
+            _frame_start = m.frame_start;
+            _depth = m.depth;
+        }
+
+        std::size_t depth() const {
+            return _depth;
+        }
+
+        // bytes allocated since the innermost frame began
+        std::size_t frame_bytes() const {
+            return _used - _frame_start;
+        }
+
+        // most bytes the arena held at once
+        std::size_t peak() const {
+            return _peak;
+        }
+    };
+
+    // one arena per thread, the iterations of a parallel for run their own frames
+    inline arena& frame_arena() {
+        thread_local arena a;
+        return a;
+    }
+
+    // a `frame { ... }` block, whatever it allocated from the arena is released when it ends
+    class frame {
+    private:
+        arena& _arena;
+        const arena::mark _mark;
+
+    public:
+        frame()
+            : _arena(frame_arena()), _mark(_arena.begin_frame()) {
+        }
+
+        frame(const frame&) = delete;
+        frame& operator=(const frame&) = delete;
+
+        ~frame() {
+            _arena.end_frame(_mark);
+        }
+    };
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+// runtime support of cern's fixed-size arrays (`var grid : int[256]`), lowered to std::array
+//
+// indexing goes through cern::at, which checks the index when CERN_BOUNDS_CHECK is defined
+// (the debug profile) and is a plain load otherwise
+
+#include <array>
+
+#include "bounds.hpp"
+
+namespace cern {
+    template <typename T, std::size_t N>
+    inline T& at(std::array<T, N>& a, long long i, int line) {
+        check_index(i, N, line);
+        return a[i];
+    }
+
+    template <typename T, std::size_t N>
+    inline const T& at(const std::array<T, N>& a, long long i, int line) {
+        check_index(i, N, line);
+        return a[i];
+    }
+}
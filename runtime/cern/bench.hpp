@@ -0,0 +1,84 @@
+#pragma once
+
+// runtime support of cern's `now_ns()`, `cycles()` and `bench(name) { ... }`
+//
+// a bench runs its body once to warm the caches up, then `runs` times, timing each run on its own
+// with the monotonic clock. the cost of reading the clock twice, measured once per program, is
+// subtracted from every sample, so an empty body measures about 0 ns
+
+#include <algorithm>
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace cern {
+    // nanoseconds since an arbitrary point, never going backward
+    inline int64_t now_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    // time stamp counter of the core, the monotonic clock in nanoseconds where there is none
+    inline uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(now_ns());
+#endif
+    }
+
+    namespace detail {
+        // nanoseconds taken by one call of `body`, timer included
+        template <typename Body>
+        inline int64_t time_once(Body& body) {
+            const int64_t start = now_ns();
+            // keep the body between the two reads of the clock
+            asm volatile("" ::: "memory");
+            body();
+            asm volatile("" ::: "memory");
+            return now_ns() - start;
+        }
+
+        // least time measured around an empty body, the cost of the timer itself
+        inline int64_t timer_overhead() {
+            static const int64_t overhead = [] {
+                auto empty = [] {};
+                int64_t best = time_once(empty);
+                for (int i = 0; i < 1000; i++)
+                    best = std::min(best, time_once(empty));
+                return best;
+            }();
+            return overhead;
+        }
+    }
+
+    // run `body` `runs` times (at least once) and print the min, median and 99th percentile of a run
+    template <typename Body>
+    void bench(const std::string& name, int64_t runs, Body&& body) {
+        if (runs < 1)
+            runs = 1;
+
+        const int64_t overhead = detail::timer_overhead();
+
+        body();
+
+        std::vector<int64_t> samples(static_cast<std::size_t>(runs));
+        for (int64_t& s : samples)
+            s = std::max<int64_t>(detail::time_once(body) - overhead, 0);
+
+        std::sort(samples.begin(), samples.end());
+
+        const std::size_t n = samples.size();
+        const std::size_t p99 = (n * 99 + 99) / 100 - 1;
+
+        std::cout << "bench " << name << ": " << n << " runs, min " << samples[0] << " ns, median " << samples[n / 2]
+                  << " ns, p99 " << samples[p99] << " ns" << std::endl;
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+// index checks shared by the containers of the runtime, enabled by defining CERN_BOUNDS_CHECK
+// (the debug profile does)
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+
+namespace cern {
+    [[noreturn]] inline void out_of_bounds(long long i, std::size_t size, int line) {
+        std::cerr << "[Runtime Error] index " << i << " out of bounds for size " << size << " on line " << line << std::endl;
+        std::abort();
+    }
+
+    inline void check_index(long long i, std::size_t size, int line) {
+#ifdef CERN_BOUNDS_CHECK
+        if (i < 0 || static_cast<std::size_t>(i) >= size)
+            out_of_bounds(i, size, line);
+#else
+        (void)i;
+        (void)size;
+        (void)line;
+#endif
+    }
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+// runtime support of cern's `bytes`, `map_file(path)`, `file_size(path)` and `write_file(path, data)`
+//
+// map_file maps the file read-only with mmap and advises the kernel it is read sequentially, so it
+// reads ahead aggressively and may free the pages behind: a file of several gigabytes is processed
+// without being copied, and without using that much memory. the copies of a `bytes` share the
+// mapping, which is unmapped with the last one
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bounds.hpp"
+
+namespace cern {
+    template <typename T>
+    class list;
+
+    // read-only view of the bytes of a mapped file
+    class bytes {
+    private:
+        struct mapping {
+            void* data;
+            std::size_t size;
+
+            mapping(void* data, std::size_t size)
+                : data(data), size(size) {
+            }
+
+            mapping(const mapping&) = delete;
+            mapping& operator=(const mapping&) = delete;
+
+            ~mapping() {
+                munmap(data, size);
+            }
+        };
+
+        std::shared_ptr<const mapping> _mapping;
+        const uint8_t* _data = nullptr;
+        std::size_t _size = 0;
+
+    public:
+        bytes() = default;
+
+        bytes(void* data, std::size_t size)
+            : _mapping(std::make_shared<const mapping>(data, size)), _data(static_cast<const uint8_t*>(data)), _size(size) {
+        }
+
+        int64_t len() const {
+            return static_cast<int64_t>(_size);
+        }
+
+        const uint8_t* data() const {
+            return _data;
+        }
+
+        uint8_t operator[](std::size_t i) const {
+            return _data[i];
+        }
+
+        bool operator==(const bytes& other) const {
+            return _size == other._size && (_size == 0 || std::memcmp(_data, other._data, _size) == 0);
+        }
+    };
+
+    inline uint8_t at(const bytes& b, long long i, int line) {
+        check_index(i, static_cast<std::size_t>(b.len()), line);
+        return b[i];
+    }
+
+    // an empty file has nothing to map, it is an empty view
+    inline bytes map_file(const std::string& path, int line) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        struct stat st;
+
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            std::cerr << "[Runtime Error] cannot map '" << path << "': " << std::strerror(errno) << " on line " << line << std::endl;
+            std::abort();
+        }
+
+        const std::size_t size = static_cast<std::size_t>(st.st_size);
+        if (size == 0) {
+            close(fd);
+            return bytes();
+        }
+
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (data == MAP_FAILED) {
+            std::cerr << "[Runtime Error] cannot map '" << path << "': " << std::strerror(errno) << " on line " << line << std::endl;
+            std::abort();
+        }
+
+        madvise(data, size, MADV_SEQUENTIAL);
+        return bytes(data, size);
+    }
+
+    // size in bytes, -1 if the file does not exist
+    inline int64_t file_size(const std::string& path) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0)
+            return -1;
+        return static_cast<int64_t>(st.st_size);
+    }
+
+    // create or truncate the file and write `size` bytes to it, false on an error
+    inline bool write_file(const std::string& path, const void* data, std::size_t size) {
+        const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            return false;
+
+        const char* p = static_cast<const char*>(data);
+        while (size > 0) {
+            const ssize_t n = write(fd, p, size);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                close(fd);
+                return false;
+            }
+
+            p += n;
+            size -= static_cast<std::size_t>(n);
+        }
+
+        return close(fd) == 0;
+    }
+
+    inline bool write_file(const std::string& path, const std::string& s) {
+        return write_file(path, s.data(), s.size());
+    }
+
+    inline bool write_file(const std::string& path, const bytes& b) {
+        return write_file(path, b.data(), static_cast<std::size_t>(b.len()));
+    }
+
+    template <typename T>
+    inline bool write_file(const std::string& path, const list<T>& l) {
+        return write_file(path, l.data(), sizeof(T) * static_cast<std::size_t>(l.len()));
+    }
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+// runtime support of cern's `read_int()`, `read_char()`, `read_line()`, `read_all()` and `eof()`
+//
+// stdin is read with read(2) in blocks of 1 MiB and parsed straight from the block: no iostream,
+// no locale, no per-character call. at the end of the input read_int returns 0, read_char '\0'
+// and read_line an empty string, which are also valid data: eof() tells them apart, it is true
+// when the last read found nothing left (like a failed `cin >> x`). read_int returns an int, a
+// number outside its range wraps around as a conversion to int does
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+namespace cern {
+    class input {
+    private:
+        static constexpr std::size_t block = 1 << 20;
+
+        std::unique_ptr<char[]> _buffer{ new char[block] };
+        // unread bytes are [_pos, _end)
+        std::size_t _pos = 0;
+        std::size_t _end = 0;
+        bool _eof = false;
+        // the last read found the end of the input instead of data
+        bool _ended = false;
+
+        // read(2) retried when interrupted, 0 at the end of the input or on an error
+        static std::size_t read_some(char* dst, std::size_t n) {
+            while (true) {
+                const ssize_t r = ::read(STDIN_FILENO, dst, n);
+                if (r >= 0)
+                    return static_cast<std::size_t>(r);
+                if (errno != EINTR)
+                    return 0;
+            }
+        }
+
+        // read the next block once the current one is consumed, false at the end of the input
+        bool fill() {
+            if (_eof)
+                return false;
+
+            _pos = 0;
+            _end = read_some(_buffer.get(), block);
+            _eof = _end == 0;
+            return !_eof;
+        }
+
+    public:
+        int64_t read_int() {
+            // whitespace and control characters before the number
+            while (true) {
+                while (_pos < _end && static_cast<unsigned char>(_buffer[_pos]) <= ' ')
+                    _pos++;
+                if (_pos < _end)
+                    break;
+                if (!fill()) {
+                    _ended = true;
+                    return 0;
+                }
+            }
+
+            _ended = false;
+
+            bool negative = false;
+            if (_buffer[_pos] == '-' || _buffer[_pos] == '+') {
+                negative = _buffer[_pos] == '-';
+                _pos++;
+            }
+
+            // wraps around on overflow, accumulated unsigned so it is not undefined
+            uint64_t value = 0;
+            while (_pos < _end || fill()) {
+                const unsigned digit = static_cast<unsigned char>(_buffer[_pos]) - '0';
+                if (digit > 9)
+                    break;
+                value = value * 10 + digit;
+                _pos++;
+            }
+
+            return static_cast<int64_t>(negative ? 0 - value : value);
+        }
+
+        char read_char() {
+            _ended = _pos == _end && !fill();
+            if (_ended)
+                return '\0';
+            return _buffer[_pos++];
+        }
+
+        // next line without its '\n' (nor the '\r' before it)
+        std::string read_line() {
+            std::string line;
+
+            // a last line without '\n' is still a line, the next read ends
+            _ended = _pos == _end && !fill();
+
+            while (_pos < _end || fill()) {
+                const char* begin = _buffer.get() + _pos;
+                const void* newline = std::memchr(begin, '\n', _end - _pos);
+
+                if (newline == nullptr) {
+                    line.append(begin, _end - _pos);
+                    _pos = _end;
+                    continue;
+                }
+
+                const std::size_t n = static_cast<const char*>(newline) - begin;
+                line.append(begin, n);
+                _pos += n + 1;
+                break;
+            }
+
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            return line;
+        }
+
+        // everything left, read straight into the string past the current block
+        std::string read_all() {
+            _ended = _pos == _end && !fill();
+
+            std::string all(_buffer.get() + _pos, _end - _pos);
+            _pos = _end;
+
+            while (!_eof) {
+                const std::size_t size = all.size();
+                all.resize(size + block);
+
+                const std::size_t n = read_some(all.data() + size, block);
+                all.resize(size + n);
+                _eof = n == 0;
+            }
+
+            return all;
+        }
+
+        bool ended() const {
+            return _ended;
+        }
+    };
+
+    inline input& stdin_input() {
+        static input in;
+        return in;
+    }
+
+    inline int read_int() {
+        return static_cast<int>(stdin_input().read_int());
+    }
+
+    inline char read_char() {
+        return stdin_input().read_char();
+    }
+
+    inline std::string read_line() {
+        return stdin_input().read_line();
+    }
+
+    inline std::string read_all() {
+        return stdin_input().read_all();
+    }
+
+    inline bool eof() {
+        return stdin_input().ended();
+    }
+}
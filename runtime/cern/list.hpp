@@ -0,0 +1,175 @@
+#pragma once
+
+// runtime support of cern's `list<T>`: one contiguous buffer that doubles when full,
+// so push is amortized O(1) and elements never live in separate allocations
+//
+// unlike std::vector<bool>, list<bool> stores one bool per byte so it stays contiguous
+//
+// a list declared in a `frame` takes its buffer from the frame arena: its buffers are never freed one
+// by one, the end of the frame releases them at once. it only grows in the arena while no inner frame
+// is open, a buffer allocated there would be released before the list; it moves to the heap instead.
+// copies, and lists moved out of the frame, are on the heap
+
+#include <memory>
+#include <utility>
+
+#include "arena.hpp"
+#include "bounds.hpp"
+
+namespace cern {
+    template <typename T>
+    class list {
+    private:
+        T* _data = nullptr;
+        std::size_t _size = 0;
+        std::size_t _capacity = 0;
+
+        // arena holding the buffer, null for the heap, and the frame depth the list was declared at
+        arena* _arena = nullptr;
+        std::size_t _depth = 0;
+
+        // move the elements into a buffer of `capacity` elements, `pushed` is constructed
+        // right after them first since it may be one of the elements being moved
+        template <typename... Pushed>
+        void grow(std::size_t capacity, Pushed&&... pushed) {
+            arena* a = _arena != nullptr && _arena->depth() == _depth ? _arena : nullptr;
+            T* data = a != nullptr ? a->allocate<T>(capacity) : std::allocator<T>().allocate(capacity);
+
+            if constexpr (sizeof...(Pushed) > 0)
+                std::construct_at(data + _size, std::forward<Pushed>(pushed)...);
+
+            std::uninitialized_move(_data, _data + _size, data);
+            release();
+
+            _data = data;
+            _capacity = capacity;
+            _arena = a;
+        }
+
+        void release() {
+            if (_data == nullptr)
+                return;
+
+            std::destroy(_data, _data + _size);
+            if (_arena == nullptr)
+                std::allocator<T>().deallocate(_data, _capacity);
+        }
+
+        void copy(const list& other) {
+            if (other._size == 0)
+                return;
+
+            _data = std::allocator<T>().allocate(other._size);
+            _capacity = other._size;
+            std::uninitialized_copy(other._data, other._data + other._size, _data);
+            _size = other._size;
+        }
+
+    public:
+        list() = default;
+
+        // empty list growing in `a`, in the innermost frame open
+        explicit list(arena& a)
+            : _arena(&a), _depth(a.depth()) {
+        }
+
+        list(const list& other) {
+            copy(other);
+        }
+
+        // the buffer of a list in an arena does not outlive its frame, it is copied
+        list(list&& other) noexcept {
+            if (other._arena != nullptr) {
+                copy(other);
+                return;
+            }
+
+            _data = std::exchange(other._data, nullptr);
+            _size = std::exchange(other._size, 0);
+            _capacity = std::exchange(other._capacity, 0);
+        }
+
+        // `other` is on the heap, so the list is too afterwards
+        list& operator=(list other) noexcept {
+            std::swap(_data, other._data);
+            std::swap(_size, other._size);
+            std::swap(_capacity, other._capacity);
+            std::swap(_arena, other._arena);
+            std::swap(_depth, other._depth);
+            return *this;
+        }
+
+        ~list() {
+            release();
+        }
+
+        void push(const T& value) {
+            if (_size == _capacity)
+                grow(_capacity == 0 ? 8 : 2 * _capacity, value);
+            else
+                std::construct_at(_data + _size, value);
+            _size++;
+        }
+
+        T pop(int line) {
+#ifdef CERN_BOUNDS_CHECK
+            if (_size == 0) {
+                std::cerr << "[Runtime Error] pop on an empty list on line " << line << std::endl;
+                std::abort();
+            }
+#else
+            (void)line;
+#endif
+            T value = std::move(_data[_size - 1]);
+            std::destroy_at(_data + _size - 1);
+            _size--;
+            return value;
+        }
+
+        void reserve(long long n) {
+            if (n > 0 && static_cast<std::size_t>(n) > _capacity)
+                grow(static_cast<std::size_t>(n));
+        }
+
+        int len() const {
+            return static_cast<int>(_size);
+        }
+
+        T* data() {
+            return _data;
+        }
+
+        const T* data() const {
+            return _data;
+        }
+
+        T& operator[](std::size_t i) {
+            return _data[i];
+        }
+
+        const T& operator[](std::size_t i) const {
+            return _data[i];
+        }
+
+        bool operator==(const list& other) const {
+            if (_size != other._size)
+                return false;
+            for (std::size_t i = 0; i < _size; i++)
+                if (!(_data[i] == other._data[i]))
+                    return false;
+            return true;
+        }
+    };
+
+    template <typename T>
+    inline T& at(list<T>& l, long long i, int line) {
+        check_index(i, l.len(), line);
+        return l[i];
+    }
+
+    template <typename T>
+    inline const T& at(const list<T>& l, long long i, int line) {
+        check_index(i, l.len(), line);
+        return l[i];
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// runtime support of cern's `for i in begin..end step s`
+//
+// the number of iterations is computed before the first one, so the loop never compares a
+// variable that went past the maximum of its type: the last step may wrap around, it is done
+// in unsigned arithmetic and its value is never used
+
+#include <cstdlib>
+#include <iostream>
+#include <type_traits>
+
+namespace cern {
+    // a step that does not move forward would loop forever
+    template <typename T>
+    inline T for_step(T step, int line) {
+        if (step <= 0) {
+            std::cerr << "[Runtime Error] for step must be positive, got " << static_cast<long long>(step) << " on line " << line << std::endl;
+            std::abort();
+        }
+        return step;
+    }
+
+    // number of values begin, begin + step, ... below end
+    template <typename T>
+    inline std::make_unsigned_t<T> trip_count(T begin, T end, T step) {
+        using U = std::make_unsigned_t<T>;
+        if (!(begin < end))
+            return 0;
+        const U distance = static_cast<U>(static_cast<U>(end) - static_cast<U>(begin));
+        return static_cast<U>((distance - 1) / static_cast<U>(step) + 1);
+    }
+
+    template <typename T>
+    inline T advance(T i, T step) {
+        using U = std::make_unsigned_t<T>;
+        return static_cast<T>(static_cast<U>(static_cast<U>(i) + static_cast<U>(step)));
+    }
+}
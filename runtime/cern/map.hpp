@@ -0,0 +1,317 @@
+#pragma once
+
+// runtime support of cern's `map<K, V>`: a flat open-addressing hash table in the style of
+// abseil's swiss tables, instead of std::unordered_map's one allocation per entry
+//
+// the entries live in one array of slots, and each slot has a control byte in a second array:
+// empty, deleted, or the 7 low bits of the hash of its key. a lookup hashes the key once and
+// compares those 7 bits with a group of 16 control bytes at a time (one SSE2 compare), then only
+// looks at the slots whose byte matched. the table grows when 7/8 of the slots are used
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace cern {
+    namespace detail {
+        // a full slot has the 7 low bits of its hash (0 to 127), free slots have the sign bit set
+        constexpr int8_t ctrl_empty = -128;
+        constexpr int8_t ctrl_deleted = -2;
+
+        constexpr std::size_t group_width = 16;
+
+        // 16 consecutive control bytes, the masks have bit i set when byte i matches
+        class group {
+        private:
+            const int8_t* ctrl;
+
+        public:
+            explicit group(const int8_t* ctrl)
+                : ctrl(ctrl) {
+            }
+
+            uint32_t match(int8_t h2) const {
+#ifdef __SSE2__
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+                return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(h2))));
+#else
+                uint32_t mask = 0;
+                for (std::size_t i = 0; i < group_width; i++)
+                    mask |= static_cast<uint32_t>(ctrl[i] == h2) << i;
+                return mask;
+#endif
+            }
+
+            uint32_t match_empty() const {
+                return match(ctrl_empty);
+            }
+
+            // empty or deleted slots
+            uint32_t match_free() const {
+#ifdef __SSE2__
+                return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))));
+#else
+                uint32_t mask = 0;
+                for (std::size_t i = 0; i < group_width; i++)
+                    mask |= static_cast<uint32_t>(ctrl[i] < 0) << i;
+                return mask;
+#endif
+            }
+        };
+
+        // murmur3's finalizer: std::hash of an integer is the integer itself, whose low bits
+        // would pick both the slot and the control byte
+        inline uint64_t mix(uint64_t h) {
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return h;
+        }
+
+        template <typename K>
+        uint64_t hash(const K& key) {
+            if constexpr (std::is_integral_v<K> || std::is_enum_v<K>)
+                return mix(static_cast<uint64_t>(key));
+            else
+                return mix(std::hash<K>{}(key));
+        }
+
+        [[noreturn]] inline void missing_key(int line) {
+            std::cerr << "[Runtime Error] key not found in map on line " << line << std::endl;
+            std::abort();
+        }
+    }
+
+    template <typename K, typename V>
+    class map {
+    private:
+        struct slot {
+            K key;
+            V value;
+        };
+
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        // _capacity + group_width bytes, the last group mirrors the first one so that a group
+        // can be loaded at any slot without wrapping around
+        int8_t* _ctrl = nullptr;
+        slot* _slots = nullptr;
+        // 0 or a power of 2, at least group_width
+        std::size_t _capacity = 0;
+        std::size_t _size = 0;
+        // empty slots that can still be used before the table is 7/8 full (deleted ones count as used)
+        std::size_t _growth_left = 0;
+
+        void set_ctrl(std::size_t i, int8_t c) {
+            _ctrl[i] = c;
+            if (i < detail::group_width)
+                _ctrl[_capacity + i] = c;
+        }
+
+        // groups are probed at triangular offsets, which visits every group of a power of 2 table
+        std::size_t find(const K& key, uint64_t h) const {
+            if (_capacity == 0)
+                return npos;
+
+            const std::size_t mask = _capacity - 1;
+            const int8_t h2 = static_cast<int8_t>(h & 0x7f);
+            std::size_t pos = (h >> 7) & mask;
+
+            for (std::size_t step = detail::group_width;; step += detail::group_width) {
+                const detail::group g(_ctrl + pos);
+
+                for (uint32_t m = g.match(h2); m != 0; m &= m - 1) {
+                    const std::size_t i = (pos + std::countr_zero(m)) & mask;
+                    if (_slots[i].key == key)
+                        return i;
+                }
+
+                // the key would have been stored in this empty slot
+                if (g.match_empty() != 0)
+                    return npos;
+
+                pos = (pos + step) & mask;
+            }
+        }
+
+        // first empty or deleted slot on the probe sequence of `h`
+        std::size_t find_free(uint64_t h) const {
+            const std::size_t mask = _capacity - 1;
+            std::size_t pos = (h >> 7) & mask;
+
+            for (std::size_t step = detail::group_width;; step += detail::group_width) {
+                const uint32_t m = detail::group(_ctrl + pos).match_free();
+                if (m != 0)
+                    return (pos + std::countr_zero(m)) & mask;
+
+                pos = (pos + step) & mask;
+            }
+        }
+
+        void allocate(std::size_t capacity) {
+            _capacity = capacity;
+            _ctrl = new int8_t[capacity + detail::group_width];
+            std::memset(_ctrl, detail::ctrl_empty, capacity + detail::group_width);
+            _slots = std::allocator<slot>().allocate(capacity);
+            _growth_left = capacity - capacity / 8 - _size;
+        }
+
+        void release() {
+            if (_capacity == 0)
+                return;
+
+            for (std::size_t i = 0; i < _capacity; i++)
+                if (_ctrl[i] >= 0)
+                    std::destroy_at(_slots + i);
+
+            delete[] _ctrl;
+            std::allocator<slot>().deallocate(_slots, _capacity);
+        }
+
+        // moves every entry to a new table, dropping the deleted slots
+        void rehash() {
+            std::size_t capacity = _capacity == 0 ? detail::group_width : _capacity;
+            // a table full of deleted slots is cleaned up in place rather than doubled
+            if (_size + 1 > capacity * 7 / 16)
+                capacity *= 2;
+
+            int8_t* old_ctrl = _ctrl;
+            slot* old_slots = _slots;
+            const std::size_t old_capacity = _capacity;
+
+            allocate(capacity);
+
+            for (std::size_t i = 0; i < old_capacity; i++) {
+                if (old_ctrl[i] < 0)
+                    continue;
+
+                const uint64_t h = detail::hash(old_slots[i].key);
+                const std::size_t j = find_free(h);
+                set_ctrl(j, static_cast<int8_t>(h & 0x7f));
+                std::construct_at(_slots + j, std::move(old_slots[i]));
+                std::destroy_at(old_slots + i);
+            }
+
+            if (old_capacity != 0) {
+                delete[] old_ctrl;
+                std::allocator<slot>().deallocate(old_slots, old_capacity);
+            }
+        }
+
+        // stores an entry whose key is not in the table, a slot must be free
+        void insert(uint64_t h, const K& key, const V& value) {
+            const std::size_t i = find_free(h);
+
+            // a deleted slot was already counted as used
+            if (_ctrl[i] == detail::ctrl_empty)
+                _growth_left--;
+
+            set_ctrl(i, static_cast<int8_t>(h & 0x7f));
+            std::construct_at(_slots + i, slot{ key, value });
+            _size++;
+        }
+
+    public:
+        map() = default;
+
+        map(const map& other)
+            : _size(other._size) {
+            if (other._capacity == 0)
+                return;
+
+            allocate(other._capacity);
+            _growth_left = other._growth_left;
+            std::memcpy(_ctrl, other._ctrl, _capacity + detail::group_width);
+
+            for (std::size_t i = 0; i < _capacity; i++)
+                if (_ctrl[i] >= 0)
+                    std::construct_at(_slots + i, other._slots[i]);
+        }
+
+        map(map&& other) noexcept
+            : _ctrl(std::exchange(other._ctrl, nullptr)), _slots(std::exchange(other._slots, nullptr)),
+              _capacity(std::exchange(other._capacity, 0)), _size(std::exchange(other._size, 0)),
+              _growth_left(std::exchange(other._growth_left, 0)) {
+        }
+
+        map& operator=(map other) noexcept {
+            std::swap(_ctrl, other._ctrl);
+            std::swap(_slots, other._slots);
+            std::swap(_capacity, other._capacity);
+            std::swap(_size, other._size);
+            std::swap(_growth_left, other._growth_left);
+            return *this;
+        }
+
+        ~map() {
+            release();
+        }
+
+        void set(const K& key, const V& value) {
+            const uint64_t h = detail::hash(key);
+
+            const std::size_t i = find(key, h);
+            if (i != npos) {
+                _slots[i].value = value;
+                return;
+            }
+
+            if (_growth_left > 0) {
+                insert(h, key, value);
+                return;
+            }
+
+            // key and value may be entries of this table, copied before the slots move
+            const K k = key;
+            const V v = value;
+            rehash();
+            insert(h, k, v);
+        }
+
+        V& get(const K& key, int line) {
+            const std::size_t i = find(key, detail::hash(key));
+            if (i == npos)
+                detail::missing_key(line);
+            return _slots[i].value;
+        }
+
+        const V& get(const K& key, int line) const {
+            const std::size_t i = find(key, detail::hash(key));
+            if (i == npos)
+                detail::missing_key(line);
+            return _slots[i].value;
+        }
+
+        bool has(const K& key) const {
+            return find(key, detail::hash(key)) != npos;
+        }
+
+        bool remove(const K& key) {
+            const std::size_t i = find(key, detail::hash(key));
+            if (i == npos)
+                return false;
+
+            std::destroy_at(_slots + i);
+            set_ctrl(i, detail::ctrl_deleted);
+            _size--;
+            return true;
+        }
+
+        int len() const {
+            return static_cast<int>(_size);
+        }
+    };
+}
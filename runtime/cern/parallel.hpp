@@ -0,0 +1,252 @@
+#pragma once
+
+// runtime support of cern's `parallel for i in a..b { }`, a small work-stealing thread pool
+//
+// each worker starts with one contiguous block of the range and runs it `grain` iterations at a
+// time from the front. a worker with nothing left steals the back half of the block of another
+// one (a lazy binary split), so uneven loops still keep every core busy and nothing is queued up
+// front, however small the grain. the calling thread works too. the number of threads is the
+// number of cores, or CERN_THREADS
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace cern {
+    namespace detail {
+        // iterations [lo, hi), as offsets from the beginning of the loop
+        struct range {
+            unsigned long long lo;
+            unsigned long long hi;
+        };
+
+        // iterations left to a worker: the owner takes them at the front, a thief splits off the back
+        class block {
+        private:
+            std::mutex m;
+            range r{ 0, 0 };
+
+        public:
+            void set(range next) {
+                std::lock_guard lock(m);
+                r = next;
+            }
+
+            // false if the block is not empty: a new loop gave it iterations since it was found empty
+            bool install(range next) {
+                std::lock_guard lock(m);
+                if (r.lo != r.hi)
+                    return false;
+                r = next;
+                return true;
+            }
+
+            std::optional<range> take(unsigned long long grain) {
+                std::lock_guard lock(m);
+                if (r.lo == r.hi)
+                    return {};
+                const unsigned long long hi = r.hi - r.lo > grain ? r.lo + grain : r.hi;
+                const range taken{ r.lo, hi };
+                r.lo = hi;
+                return taken;
+            }
+
+            // the back half, or everything when it is no more than one grain
+            std::optional<range> split(unsigned long long grain) {
+                std::lock_guard lock(m);
+                if (r.lo == r.hi)
+                    return {};
+                const unsigned long long size = r.hi - r.lo;
+                const unsigned long long mid = size <= grain ? r.lo : r.lo + size / 2;
+                const range stolen{ mid, r.hi };
+                r.hi = mid;
+                return stolen;
+            }
+        };
+
+        // true on the pool threads and on the thread running a loop, a parallel loop started from
+        // one of them (a function called by the body can hold one) runs inline
+        inline thread_local bool in_worker = false;
+
+        class pool {
+        private:
+            using body_fn = void (*)(const void*, unsigned long long, unsigned long long);
+
+            std::vector<std::thread> threads;
+            // one block per worker, the calling thread uses the first one
+            std::vector<block> blocks;
+
+            std::mutex m;
+            std::condition_variable wake;
+            unsigned long long job = 0;
+            bool stop = false;
+
+            // set before the blocks, read after taking from one (ordered by the block mutex)
+            body_fn body = nullptr;
+            const void* ctx = nullptr;
+            unsigned long long grain = 1;
+
+            // iterations of the current loop not finished yet
+            std::atomic<unsigned long long> remaining{ 0 };
+
+            static size_t thread_count() {
+                if (const char* env = std::getenv("CERN_THREADS")) {
+                    const long n = std::atol(env);
+                    if (n > 0)
+                        return n;
+                }
+                return std::max(1u, std::thread::hardware_concurrency());
+            }
+
+            void work(size_t self) {
+                const size_t n = blocks.size();
+
+                while (remaining.load(std::memory_order_acquire) > 0) {
+                    std::optional<range> r = blocks[self].take(grain);
+
+                    // this block is done, continue with half of another one (all of it at once if this
+                    // block was refilled in the meantime, it is not put in a block others can split)
+                    for (size_t k = 1; k < n && !r.has_value(); k++) {
+                        if (const auto stolen = blocks[(self + k) % n].split(grain))
+                            r = blocks[self].install(stolen.value()) ? blocks[self].take(grain) : stolen;
+                    }
+
+                    // the last iterations are running on other workers
+                    if (!r.has_value()) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+
+                    body(ctx, r->lo, r->hi);
+                    remaining.fetch_sub(r->hi - r->lo, std::memory_order_release);
+                }
+            }
+
+            void worker_main(size_t self) {
+                in_worker = true;
+                unsigned long long seen = 0;
+
+                while (true) {
+                    {
+                        std::unique_lock lock(m);
+                        wake.wait(lock, [&] { return stop || job != seen; });
+                        if (stop)
+                            return;
+                        seen = job;
+                    }
+
+                    work(self);
+                }
+            }
+
+        public:
+            pool()
+                : blocks(thread_count()) {
+                for (size_t i = 1; i < blocks.size(); i++)
+                    threads.emplace_back([this, i] { worker_main(i); });
+            }
+
+            ~pool() {
+                {
+                    std::lock_guard lock(m);
+                    stop = true;
+                }
+                wake.notify_all();
+
+                for (std::thread& t : threads)
+                    t.join();
+            }
+
+            size_t size() const {
+                return blocks.size();
+            }
+
+            // run iterations [0, count) in chunks of `g`
+            void run(unsigned long long count, unsigned long long g, body_fn f, const void* c) {
+                const size_t n = blocks.size();
+
+                body = f;
+                ctx = c;
+                grain = g;
+
+                // counted before any block is set: a worker still leaving the previous loop may take
+                // iterations as soon as they are there, its fetch_sub must not be overwritten
+                remaining.store(count, std::memory_order_release);
+
+                // worker k starts with the k-th contiguous block, the first count % n one iteration longer
+                unsigned long long lo = 0;
+                for (size_t k = 0; k < n; k++) {
+                    const unsigned long long size = count / n + (k < count % n ? 1 : 0);
+                    blocks[k].set({ lo, lo + size });
+                    lo += size;
+                }
+
+                {
+                    std::lock_guard lock(m);
+                    job++;
+                }
+                wake.notify_all();
+
+                work(0);
+            }
+        };
+
+        inline pool& global_pool() {
+            static pool p;
+            return p;
+        }
+
+        // begin + offset in the type of the loop, without overflowing on the way
+        template <typename T>
+        inline T offset(T begin, unsigned long long o) {
+            using U = std::make_unsigned_t<T>;
+            return static_cast<T>(static_cast<U>(static_cast<U>(begin) + static_cast<U>(o)));
+        }
+    }
+
+    // calls f(lo, hi) on disjoint chunks covering [begin, end), from every worker of the pool
+    // grain is the number of iterations of a chunk, 0 picks about 8 chunks per worker
+    // the number of iterations is computed unsigned, a range over a whole i64 or u64 does not overflow
+    template <typename T, typename F>
+    void parallel_for(T begin, T end, long long grain, const F& f) {
+        if (!(begin < end))
+            return;
+
+        if (detail::in_worker) {
+            f(begin, end);
+            return;
+        }
+
+        using U = std::make_unsigned_t<T>;
+        const unsigned long long count = static_cast<U>(static_cast<U>(end) - static_cast<U>(begin));
+
+        detail::pool& pool = detail::global_pool();
+
+        const unsigned long long g = grain > 0 ? static_cast<unsigned long long>(grain) : std::max(1ULL, count / (pool.size() * 8));
+
+        if (pool.size() == 1 || count <= g) {
+            f(begin, end);
+            return;
+        }
+
+        struct loop {
+            T begin;
+            const F* f;
+        };
+        const loop l{ begin, &f };
+
+        // the pool runs one loop at a time, the chunks run by this thread must not start another
+        detail::in_worker = true;
+        pool.run(count, g, [](const void* ctx, unsigned long long lo, unsigned long long hi) {
+            const loop& l = *static_cast<const loop*>(ctx);
+            (*l.f)(detail::offset(l.begin, lo), detail::offset(l.begin, hi));
+        }, &l);
+        detail::in_worker = false;
+    }
+}
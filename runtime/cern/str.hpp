@@ -0,0 +1,93 @@
+#pragma once
+
+// runtime support of cern's string literals, `str_view`, `s[begin..end]` and `s[i]` on strings and views
+//
+// a slice is a std::string_view into the characters of the string: nothing is copied. the compiler
+// checks a view never outlives the string it points into, and that the string is not modified
+// while a view points into it
+//
+// every distinct string literal of a program is a single `literal` constant: printing it or comparing
+// a string to it allocates nothing, a std::string is only built where one is stored
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "bounds.hpp"
+
+namespace cern {
+    // a view of a string literal, converted implicitly to a std::string where one is needed
+    struct literal : std::string_view {
+        // the size of the array rather than strlen, a literal may contain '\0'
+        template <std::size_t N>
+        constexpr literal(const char (&s)[N])
+            : std::string_view(s, N - 1) {
+        }
+
+        operator std::string() const {
+            return std::string(data(), size());
+        }
+    };
+
+    // std::string has no + with a string_view before C++26
+    inline std::string operator+(const std::string& a, literal b) {
+        std::string r;
+        r.reserve(a.size() + b.size());
+        r.append(a).append(b);
+        return r;
+    }
+
+    inline std::string operator+(std::string&& a, literal b) {
+        a.append(b);
+        return std::move(a);
+    }
+
+    inline std::string operator+(literal a, const std::string& b) {
+        std::string r;
+        r.reserve(a.size() + b.size());
+        r.append(a).append(b);
+        return r;
+    }
+
+    inline std::string operator+(literal a, literal b) {
+        std::string r;
+        r.reserve(a.size() + b.size());
+        r.append(a).append(b);
+        return r;
+    }
+
+    inline std::string operator+(literal a, char c) {
+        std::string r;
+        r.reserve(a.size() + 1);
+        r.append(a).push_back(c);
+        return r;
+    }
+
+    inline std::string operator+(char c, literal b) {
+        std::string r;
+        r.reserve(b.size() + 1);
+        r.push_back(c);
+        r.append(b);
+        return r;
+    }
+
+    inline std::string_view slice(std::string_view s, long long begin, long long end, int line) {
+#ifdef CERN_BOUNDS_CHECK
+        if (begin < 0 || begin > end || static_cast<std::size_t>(end) > s.size()) {
+            std::cerr << "[Runtime Error] slice " << begin << ".." << end << " out of bounds for size " << s.size() << " on line " << line << std::endl;
+            std::abort();
+        }
+#else
+        (void)line;
+#endif
+        return std::string_view(s.data() + begin, static_cast<std::size_t>(end - begin));
+    }
+
+    inline char at(std::string_view s, long long i, int line) {
+        check_index(i, s.size(), line);
+        return s[i];
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+// runtime support of cern's vector types (`var v : vec3`), lowered to GCC vector extensions
+//
+// arithmetic on them is element-wise and compiles to SSE instructions (AVX when the backend
+// is allowed to use it). vec3 is padded to 4 lanes so it fits in a single register, its last
+// lane is never read back
+
+#include <ostream>
+
+namespace cern {
+    typedef float vec2 __attribute__((vector_size(8)));
+    typedef float vec3 __attribute__((vector_size(16)));
+    typedef float vec4 __attribute__((vector_size(16)));
+
+    // a vector with its first N lanes set to s
+    template <typename V, int N>
+    inline V splat(float s) {
+        V v{};
+        for (int i = 0; i < N; i++)
+            v[i] = s;
+        return v;
+    }
+
+    // prints the first N lanes of a vector, as (x, y, z)
+    template <typename V, int N>
+    struct shown {
+        V v;
+    };
+
+    template <int N, typename V>
+    inline shown<V, N> show(V v) {
+        return { v };
+    }
+
+    template <typename V, int N>
+    std::ostream& operator<<(std::ostream& os, const shown<V, N>& s) {
+        os << "(";
+        for (int i = 0; i < N; i++)
+            os << (i > 0 ? ", " : "") << s.v[i];
+        return os << ")";
+    }
+}
@@ -1,22 +1,51 @@
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdlib>
 #include <memory>
 #include <utility>
 #include <iostream>
+#include <vector>
 
+// bump allocator of the AST: objects live as long as the arena, which grows by chaining blocks,
+// each twice as large as the previous one, so a large program never runs out of room
 class ArenaAllocator final
 {
 private:
-    size_t _size;
-    std::byte *_buffer;
-    std::byte *_offset;
+    std::vector<std::unique_ptr<std::byte[]>> _blocks;
+    // size of the next block
+    std::size_t _next_size;
+    // [_begin, _end) is the current block, [_begin, _offset) is handed out
+    std::byte *_begin{nullptr};
+    std::byte *_offset{nullptr};
+    std::byte *_end{nullptr};
+    // bytes handed out in the blocks before the current one
+    std::size_t _used_before{0};
+    // bytes of every block
+    std::size_t _capacity{0};
+    std::size_t _num_allocs{0};
+
+    // start a new block with room for at least min_num_bytes
+    void grow(const std::size_t min_num_bytes)
+    {
+        const std::size_t size = std::max(_next_size, min_num_bytes);
+        _blocks.emplace_back(new std::byte[size]);
+
+        _used_before += static_cast<std::size_t>(_offset - _begin);
+        _capacity += size;
+        _next_size = size * 2;
+
+        _begin = _blocks.back().get();
+        _offset = _begin;
+        _end = _begin + size;
+    }
 
 public:
-    ArenaAllocator(const std::size_t max_num_bytes)
-        : _size{max_num_bytes}, _buffer{new std::byte[max_num_bytes]}, _offset{_buffer}
+    ArenaAllocator(const std::size_t first_block_bytes)
+        : _next_size{first_block_bytes}
     {
+        grow(first_block_bytes);
     }
 
     ArenaAllocator(const ArenaAllocator &) = delete;
@@ -24,29 +53,39 @@ public:
     ArenaAllocator &operator=(const ArenaAllocator &) = delete;
 
     ArenaAllocator(ArenaAllocator &&other) noexcept
-        : _size{std::exchange(other._size, 0)}, _buffer{std::exchange(other._buffer, nullptr)}, _offset{std::exchange(other._offset, nullptr)}
+        : _blocks{std::move(other._blocks)}, _next_size{other._next_size}, _begin{std::exchange(other._begin, nullptr)}, _offset{std::exchange(other._offset, nullptr)}, _end{std::exchange(other._end, nullptr)}, _used_before{std::exchange(other._used_before, 0)}, _capacity{std::exchange(other._capacity, 0)}, _num_allocs{std::exchange(other._num_allocs, 0)}
     {
     }
 
     ArenaAllocator &operator=(ArenaAllocator &&other) noexcept
     {
-        std::swap(_size, other._size);
-        std::swap(_buffer, other._buffer);
+        std::swap(_blocks, other._blocks);
+        std::swap(_next_size, other._next_size);
+        std::swap(_begin, other._begin);
         std::swap(_offset, other._offset);
+        std::swap(_end, other._end);
+        std::swap(_used_before, other._used_before);
+        std::swap(_capacity, other._capacity);
+        std::swap(_num_allocs, other._num_allocs);
         return *this;
     }
 
     template <typename T>
     [[nodiscard]] T *alloc()
     {
-        std::size_t remaining_num_bytes = _size - static_cast<std::size_t>(_offset - _buffer);
+        std::size_t remaining_num_bytes = static_cast<std::size_t>(_end - _offset);
         auto pointer = static_cast<void *>(_offset);
-        const auto aligned_address = std::align(alignof(T), sizeof(T), pointer, remaining_num_bytes);
+        auto aligned_address = std::align(alignof(T), sizeof(T), pointer, remaining_num_bytes);
         if (aligned_address == nullptr)
         {
-            throw std::bad_alloc{};
+            grow(sizeof(T) + alignof(T));
+
+            remaining_num_bytes = static_cast<std::size_t>(_end - _offset);
+            pointer = static_cast<void *>(_offset);
+            aligned_address = std::align(alignof(T), sizeof(T), pointer, remaining_num_bytes);
         }
         _offset = static_cast<std::byte *>(aligned_address) + sizeof(T);
+        _num_allocs++;
         return static_cast<T *>(aligned_address);
     }
 
@@ -57,8 +96,21 @@ public:
         return new (allocated_memory) T{std::forward<Args>(args)...};
     }
 
-    ~ArenaAllocator()
+    // bytes handed out so far, alignment padding included
+    [[nodiscard]] std::size_t used() const
+    {
+        return _used_before + static_cast<std::size_t>(_offset - _begin);
+    }
+
+    // bytes of every block
+    [[nodiscard]] std::size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    // number of objects allocated so far
+    [[nodiscard]] std::size_t num_allocs() const
     {
-        delete[] _buffer;
+        return _num_allocs;
     }
 };
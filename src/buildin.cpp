@@ -5,79 +5,304 @@
 #include "generation.h"
 
 namespace {
-    void exit_with(const std::string& err_msg)
+    void exit_with(const std::string& err_msg, int line)
     {
-        std::cerr << "[Error] " << err_msg << std::endl;
+        std::cerr << "[Error] " << err_msg << " on line " << line << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    std::string print_call(const std::vector<Node::Expr*>& args)
+    void check_arg_count(const Node::FuncCall* fcall, size_t count)
+    {
+        const std::string& func = fcall->ident.val.value();
+
+        if (fcall->args.size() < count)
+            exit_with("function `" + func + "` require " + std::to_string(count) + " argument(s)", fcall->ident.line);
+        if (fcall->args.size() > count)
+            exit_with("too many arguments in function call", fcall->ident.line);
+    }
+
+    void check_list_arg(const Node::FuncCall* fcall)
+    {
+        if (fcall->args[0]->type.kind != VarType::LIST)
+            exit_with(fcall->ident.val.value() + " first argument type must be a list", fcall->ident.line);
+    }
+
+    // first argument is a map, second one a key of that map
+    void check_map_args(const Node::FuncCall* fcall)
+    {
+        const std::string& func = fcall->ident.val.value();
+        const VarType& t = fcall->args[0]->type;
+
+        if (t.kind != VarType::MAP)
+            exit_with(func + " first argument type must be a map", fcall->ident.line);
+        if (fcall->args[1]->type != *t.key)
+            exit_with(func + " key type must be " + to_string(*t.key), fcall->ident.line);
+    }
+
+    std::string print_call(const Node::FuncCall* fcall)
     {
         std::stringstream ss;
 
         ss << "std::cout";
 
-        for (size_t i = 0; i < args.size(); i++)
+        for (const Node::Expr* arg : fcall->args)
         {
-            ss << " << " << gen::expr(args[i]);
+            if (arg->type.is_container() || arg->type.kind == VarType::STRUCT || arg->type.kind == VarType::MAP || arg->type.kind == VarType::BYTES)
+                exit_with("cannot print a value of type " + to_string(arg->type), fcall->ident.line);
+
+            // parenthesized, `<<` binds tighter than the comparisons
+            if (arg->type.is_vector())
+                ss << " << cern::show<" << arg->type.lanes() << ">(" << gen::expr(arg) << ")";
+            else if (arg->type.bits() == 8)
+                // promoted, i8 and u8 are printed as numbers rather than characters
+                ss << " << +(" << gen::expr(arg) << ")";
+            else
+                ss << " << (" << gen::expr(arg) << ")";
         }
-        
-        ss << ";\n";
 
         return ss.str();
     }
 
-    std::string println_call(const std::vector<Node::Expr*>& args)
+    std::string println_call(const Node::FuncCall* fcall)
     {
-        std::stringstream ss;
+        return print_call(fcall) + " << std::endl";
+    }
 
-        ss << "std::cout";
+    std::string itoc_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 1);
+        if (fcall->args[0]->type != VarType::INT)
+            exit_with("itoc argument type must be int", fcall->ident.line);
+
+        return "(char)(" + gen::expr(fcall->args[0]) + "+ '0')";
+    }
+
+    std::string ctoi_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 1);
+        if (fcall->args[0]->type != VarType::CHAR)
+            exit_with("ctoi argument type must be char", fcall->ident.line);
+
+        return "("+ gen::expr(fcall->args[0]) + " - '0')";
+    }
+
+    std::string push_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 2);
+        check_list_arg(fcall);
+        if (fcall->args[1]->type != *fcall->args[0]->type.elem)
+            exit_with("push value type must be " + to_string(*fcall->args[0]->type.elem), fcall->ident.line);
+
+        return gen::expr(fcall->args[0]) + ".push(" + gen::expr(fcall->args[1]) + ")";
+    }
+
+    std::string pop_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 1);
+        check_list_arg(fcall);
+
+        return gen::expr(fcall->args[0]) + ".pop(" + std::to_string(fcall->ident.line) + ")";
+    }
+
+    std::string reserve_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 2);
+        check_list_arg(fcall);
+        if (!fcall->args[1]->type.is_integer())
+            exit_with("reserve size type must be an integer", fcall->ident.line);
+
+        return gen::expr(fcall->args[0]) + ".reserve(" + gen::expr(fcall->args[1]) + ")";
+    }
+
+    std::string get_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 2);
+        check_map_args(fcall);
+
+        return gen::expr(fcall->args[0]) + ".get(" + gen::expr(fcall->args[1]) + ", " + std::to_string(fcall->ident.line) + ")";
+    }
+
+    std::string set_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 3);
+        check_map_args(fcall);
+        if (fcall->args[2]->type != *fcall->args[0]->type.elem)
+            exit_with("set value type must be " + to_string(*fcall->args[0]->type.elem), fcall->ident.line);
+
+        return gen::expr(fcall->args[0]) + ".set(" + gen::expr(fcall->args[1]) + ", " + gen::expr(fcall->args[2]) + ")";
+    }
 
-        for (size_t i = 0; i < args.size(); i++)
+    std::string has_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 2);
+        check_map_args(fcall);
+
+        return gen::expr(fcall->args[0]) + ".has(" + gen::expr(fcall->args[1]) + ")";
+    }
+
+    std::string remove_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 2);
+        check_map_args(fcall);
+
+        return gen::expr(fcall->args[0]) + ".remove(" + gen::expr(fcall->args[1]) + ")";
+    }
+
+    std::string len_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 1);
+
+        const VarType& t = fcall->args[0]->type;
+
+        switch (t.kind)
         {
-            ss << " << " << gen::expr(args[i]);
+        case VarType::ARRAY:
+            return std::to_string(t.size);
+        case VarType::LIST:
+        case VarType::MAP:
+        case VarType::BYTES:
+            return gen::expr(fcall->args[0]) + ".len()";
+        case VarType::STRING:
+        case VarType::STR_VIEW:
+            return "static_cast<int>(" + gen::expr(fcall->args[0]) + ".size())";
+        default:
+            exit_with("len argument must be a string, a str_view, an array, a list, a map or bytes", fcall->ident.line);
+            return ""; // unreachable
         }
-        
-        ss << " << std::endl;\n";
+    }
 
-        return ss.str();
+    // bytes the lists of the innermost frame took from the arena so far
+    std::string frame_bytes_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 0);
+        gen::include("<cstdint>");
+        gen::include("\"cern/arena.hpp\"");
+
+        return "static_cast<int64_t>(cern::frame_arena().frame_bytes())";
+    }
+
+    // most bytes the frames of the thread held at once
+    std::string frame_peak_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 0);
+        gen::include("<cstdint>");
+        gen::include("\"cern/arena.hpp\"");
+
+        return "static_cast<int64_t>(cern::frame_arena().peak())";
+    }
+
+    // monotonic clock in nanoseconds
+    std::string now_ns_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 0);
+        gen::include("\"cern/bench.hpp\"");
+
+        return "cern::now_ns()";
     }
 
-    std::string itoc_call(const std::vector<Node::Expr*>& args)
+    // time stamp counter of the core
+    std::string cycles_call(const Node::FuncCall* fcall)
     {
-        if (args.empty())
-            exit_with("function `itoc` require an argument");
-        if (args[0]->type != VarType::INT)
-            exit_with("itoc argument type must be int");
-        if (args.size() > 1)
-            exit_with("too many arguments in function call");
+        check_arg_count(fcall, 0);
+        gen::include("\"cern/bench.hpp\"");
 
-        return "(char)(" + gen::expr(args[0]) + "+ '0')";
+        return "cern::cycles()";
     }
 
-    std::string ctoi_call(const std::vector<Node::Expr*>& args)
+    // read_int, read_char, read_line and read_all parse stdin from the same buffer, eof tells if the last one ended it
+    std::string read_call(const Node::FuncCall* fcall)
     {
-        if (args.empty())
-            exit_with("function `ctoi` require an argument");
-        if (args[0]->type != VarType::CHAR)
-            exit_with("itoc argument type must be char");
-        if (args.size() > 1)
-            exit_with("too many arguments in function call");
+        check_arg_count(fcall, 0);
+        gen::include("\"cern/input.hpp\"");
+
+        return "cern::" + fcall->ident.val.value() + "()";
+    }
 
-        return "("+ gen::expr(args[0]) + " - '0')";
+    void check_path_arg(const Node::FuncCall* fcall)
+    {
+        if (fcall->args[0]->type.kind != VarType::STRING)
+            exit_with(fcall->ident.val.value() + " path must be a string", fcall->ident.line);
+    }
+
+    std::string map_file_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 1);
+        check_path_arg(fcall);
+        gen::include("\"cern/file.hpp\"");
+
+        return "cern::map_file(" + gen::expr(fcall->args[0]) + ", " + std::to_string(fcall->ident.line) + ")";
+    }
+
+    std::string file_size_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 1);
+        check_path_arg(fcall);
+        gen::include("\"cern/file.hpp\"");
+
+        return "cern::file_size(" + gen::expr(fcall->args[0]) + ")";
+    }
+
+    // the data is a string, bytes, or a list<u8> or list<char> written as is
+    std::string write_file_call(const Node::FuncCall* fcall)
+    {
+        check_arg_count(fcall, 2);
+        check_path_arg(fcall);
+
+        const VarType& t = fcall->args[1]->type;
+        const bool byte_list = t.kind == VarType::LIST && (t.elem->kind == VarType::U8 || t.elem->kind == VarType::CHAR);
+        if (t.kind != VarType::STRING && t.kind != VarType::BYTES && !byte_list)
+            exit_with("write_file data must be a string, bytes, a list<u8> or a list<char>", fcall->ident.line);
+
+        gen::include("\"cern/file.hpp\"");
+
+        return "cern::write_file(" + gen::expr(fcall->args[0]) + ", " + gen::expr(fcall->args[1]) + ")";
     }
 }
 
-std::optional<std::string> call_func(std::string func, const std::vector<Node::Expr*>& args)
+std::optional<std::string> call_func(const Node::FuncCall* fcall)
 {
+    const std::string& func = fcall->ident.val.value();
+
     if (func == "print")
-        return print_call(args);
+        return print_call(fcall);
     else if (func == "println")
-        return println_call(args);
+        return println_call(fcall);
     else if (func == "itoc")
-        return itoc_call(args);
+        return itoc_call(fcall);
     else if (func == "ctoi")
-        return ctoi_call(args);
-    
+        return ctoi_call(fcall);
+    else if (func == "push")
+        return push_call(fcall);
+    else if (func == "pop")
+        return pop_call(fcall);
+    else if (func == "reserve")
+        return reserve_call(fcall);
+    else if (func == "len")
+        return len_call(fcall);
+    else if (func == "get")
+        return get_call(fcall);
+    else if (func == "set")
+        return set_call(fcall);
+    else if (func == "has")
+        return has_call(fcall);
+    else if (func == "remove")
+        return remove_call(fcall);
+    else if (func == "frame_bytes")
+        return frame_bytes_call(fcall);
+    else if (func == "frame_peak")
+        return frame_peak_call(fcall);
+    else if (func == "now_ns")
+        return now_ns_call(fcall);
+    else if (func == "cycles")
+        return cycles_call(fcall);
+    else if (func == "read_int" || func == "read_char" || func == "read_line" || func == "read_all" || func == "eof")
+        return read_call(fcall);
+    else if (func == "map_file")
+        return map_file_call(fcall);
+    else if (func == "file_size")
+        return file_size_call(fcall);
+    else if (func == "write_file")
+        return write_file_call(fcall);
+
     return {};
 }
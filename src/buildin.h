@@ -2,4 +2,5 @@
 
 #include "parser.h"
 
-std::optional<std::string> call_func(std::string func, const std::vector<Node::Expr*>& args = {});
+// generate the c++ expression of a call to a buildin function (empty if the function is not a buildin)
+std::optional<std::string> call_func(const Node::FuncCall* fcall);
@@ -1,11 +1,15 @@
 #include "generation.h"
 
 #include "buildin.h"
+#include "trace.h"
 
 #include <sstream>
 #include <cassert>
 #include <algorithm>
+#include <cctype>
+#include <limits>
 #include <stack>
+#include <set>
 
 namespace gen {
     namespace {
@@ -15,6 +19,151 @@ namespace gen {
         std::stack<std::stringstream> scope_stack;
 
         std::string indentation;
+
+        // headers needed by the generated code, besides iostream and string
+        std::set<std::string> includes;
+
+        // declared enums, to name their values in the cases of a match
+        std::unordered_map<std::string, const Node::EnumDeclaration*> enums;
+
+        // generating an imported module rather than the program
+        bool in_module = false;
+
+        // one constant per distinct string literal, named by its content, declared in order of use
+        std::unordered_map<std::string, std::string> literals;
+        std::vector<std::string> literal_values;
+
+        std::string literal(const std::string& value) {
+            const auto [it, inserted] = literals.try_emplace(value, "cern_str_" + std::to_string(literals.size()));
+            if (inserted) {
+                include("\"cern/str.hpp\"");
+                literal_values.push_back(value);
+            }
+            return it->second;
+        }
+    }
+
+    std::string type(const VarType& t) {
+        switch (t.kind) {
+        case VarType::ARRAY:
+            // each struct declares its column-wise counterpart, Name_soa<N>
+            if (t.soa)
+                return t.elem->name + "_soa<" + std::to_string(t.size) + ">";
+            include("<array>");
+            include("\"cern/array.hpp\"");
+            return "std::array<" + type(*t.elem) + ", " + std::to_string(t.size) + ">";
+        case VarType::STRUCT:
+            return t.name;
+        case VarType::LIST:
+            include("\"cern/list.hpp\"");
+            return "cern::list<" + type(*t.elem) + ">";
+        case VarType::MAP:
+            include("\"cern/map.hpp\"");
+            return "cern::map<" + type(*t.key) + ", " + type(*t.elem) + ">";
+        case VarType::BYTES:
+            include("\"cern/file.hpp\"");
+            return "cern::bytes";
+        case VarType::STR_VIEW:
+            include("<string_view>");
+            return "std::string_view";
+        case VarType::VEC2:
+        case VarType::VEC3:
+        case VarType::VEC4:
+            include("\"cern/vec.hpp\"");
+            return "cern::" + to_string(t);
+        case VarType::I8:
+        case VarType::I16:
+        case VarType::I64:
+        case VarType::U8:
+        case VarType::U16:
+        case VarType::U32:
+        case VarType::U64:
+            include("<cstdint>");
+            return std::string(t.is_unsigned() ? "uint" : "int") + std::to_string(t.bits()) + "_t";
+        default:
+            return to_string(t);
+        }
+    }
+
+    std::string param(const Node::Param* p) {
+        const std::string name = p->ident.val.value();
+
+        if (p->ref)
+            return type(p->type) + "& " + name;
+
+        // scalars, vectors and views (a pointer and a size) fit in registers, everything else is only read through a reference
+        if (p->type.is_scalar() || p->type.kind == VarType::STR_VIEW)
+            return type(p->type) + " " + name;
+        return "const " + type(p->type) + "& " + name;
+    }
+
+    void include(const std::string& header) {
+        includes.insert(header);
+    }
+
+    std::string as_float(const Node::Expr* e) {
+        if (e->type == VarType::FLOAT)
+            return expr(e);
+        return "static_cast<float>(" + expr(e) + ")";
+    }
+
+    bool narrowed(const Node::Expr* e) {
+        const bool computed = std::holds_alternative<Node::BinExpr*>(e->var) || std::holds_alternative<Node::ExprBitNot*>(e->var);
+        return computed && e->type.is_integer() && e->type.bits() < 32;
+    }
+
+    int cpp_prec(TokenType op) {
+        switch (op) {
+        case TokenType::OR:
+            return 0;
+        case TokenType::AND:
+            return 1;
+        case TokenType::BIT_OR:
+            return 2;
+        case TokenType::BIT_XOR:
+            return 3;
+        case TokenType::BIT_AND:
+            return 4;
+        case TokenType::IS_EQUAL:
+        case TokenType::IS_NOT_EQUAL:
+            return 5;
+        case TokenType::GREATER_OR_EQUAL:
+        case TokenType::GREATER:
+        case TokenType::LOWER_OR_EQUAL:
+        case TokenType::LOWER:
+            return 6;
+        case TokenType::SHIFT_LEFT:
+        case TokenType::SHIFT_RIGHT:
+            return 7;
+        case TokenType::PLUS:
+        case TokenType::MINUS:
+            return 8;
+        default:
+            return 9;
+        }
+    }
+
+    std::string operand(const Node::Expr* e, const Node::Expr* other, TokenType op, bool right) {
+        if (other->type.is_vector() && !e->type.is_vector() && e->type != VarType::FLOAT)
+            return as_float(e);
+
+        const auto bin = std::get_if<Node::BinExpr*>(&e->var);
+        if (bin == nullptr || narrowed(e))
+            return expr(e);
+
+        const int prec = cpp_prec((*bin)->op);
+        const int parent = cpp_prec(op);
+
+        // the bitwise operators and && inside || are also parenthesized when c++ would not need it, as -Wparentheses asks
+        const auto bitwise = [](TokenType t) {
+            return t == TokenType::BIT_AND || t == TokenType::BIT_OR || t == TokenType::BIT_XOR ||
+                   t == TokenType::SHIFT_LEFT || t == TokenType::SHIFT_RIGHT;
+        };
+        const bool mixed = (*bin)->op != op && (bitwise((*bin)->op) || bitwise(op) || op == TokenType::OR);
+
+        if (prec < parent || (right && prec == parent) || mixed)
+            return "(" + expr(e) + ")";
+        return expr(e);
     }
 
     void begin_scope() {
@@ -47,9 +196,24 @@ namespace gen {
         exit(EXIT_FAILURE);
     }
 
-    std::string prog(const Node::Prog p) {
+    std::string prog(const Node::Prog p, bool module) {
+        // every module is generated by the same process, one after the other
+        output.str("");
+        current_scope.str("");
+        indentation.clear();
+        includes.clear();
+        enums.clear();
+        literals.clear();
+        literal_values.clear();
+        in_module = module;
+
+        for (const Node::ProgStmt* s : p.stmts)
+            prog_stmt(s);
+
         output << "#include <iostream>" << std::endl;
         output << "#include <string>" << std::endl;
+        for (const std::string& header : includes)
+            output << "#include " << header << std::endl;
 
         output << std::endl;
 
@@ -57,8 +221,11 @@ namespace gen {
 
         output << std::endl;
 
-        for (const Node::ProgStmt* s : p.stmts)
-            prog_stmt(s);
+        if (!literal_values.empty()) {
+            for (size_t i = 0; i < literal_values.size(); i++)
+                output << "static constexpr cern::literal cern_str_" << i << " = \"" << literal_values[i] << "\";" << std::endl;
+            output << std::endl;
+        }
 
         output << current_scope.str();
 
@@ -67,9 +234,23 @@ namespace gen {
 
     void prog_stmt(const Node::ProgStmt* s) {
         struct ProgStmtVisitor {
+            // the declarations of the module, defined by its own object file
+            void operator()(const Node::Import* imp) const {
+                if (imp->decls.empty())
+                    return;
+
+                current_scope << "\n";
+                current_scope << indentation << "// " << imp->path.val.value() << "\n";
+                for (const Node::ProgStmt* decl : imp->decls)
+                    prog_stmt(decl);
+            }
+
+            // the globals of a module are not exported, two modules can use the same names
             void operator()(const Node::StmtImplicitVar* stmt_var) const {
                 current_scope << indentation;
-                current_scope << to_string(stmt_var->expr->type);
+                if (in_module)
+                    current_scope << "static ";
+                current_scope << type(stmt_var->type);
                 current_scope << " ";
                 current_scope << stmt_var->identifier.val.value();
                 current_scope << " = ";
@@ -79,19 +260,91 @@ namespace gen {
 
             void operator()(const Node::StmtExplicitVar* stmt_var) const {
                 current_scope << indentation;
-                current_scope << to_string(stmt_var->type);
+                if (in_module)
+                    current_scope << "static ";
+                current_scope << type(stmt_var->type);
                 current_scope << " ";
                 current_scope << stmt_var->ident.val.value();
+                if (stmt_var->type.kind == VarType::ARRAY || stmt_var->type.kind == VarType::ENUM)
+                    current_scope << "{}";
                 current_scope << ";\n";
             }
 
+            void operator()(const Node::StmtConst* stmt_const) const {
+                current_scope << indentation;
+                current_scope << "constexpr " << type(stmt_const->type) << " " << stmt_const->ident.val.value();
+                current_scope << " = " << expr(stmt_const->expr) << ";\n";
+            }
+
+            // one byte per value up to 256 values, printed by name
+            void operator()(const Node::EnumDeclaration* en) const {
+                const std::string name = en->ident.val.value();
+                const size_t count = en->values.size();
+
+                enums[name] = en;
+                include("<cstdint>");
+
+                current_scope << "\n";
+                current_scope << indentation << "enum class " << name << " : ";
+                current_scope << (count <= 256 ? "uint8_t" : count <= 65536 ? "uint16_t" : "uint32_t") << " {";
+                for (size_t i = 0; i < count; i++)
+                    current_scope << (i > 0 ? ", " : " ") << en->values[i].val.value();
+                current_scope << " };\n";
+
+                current_scope << "\n";
+                current_scope << indentation << "inline std::ostream& operator<<(std::ostream& os, " << name << " v) {\n";
+                current_scope << indentation << "  static constexpr const char* names[] = {";
+                for (size_t i = 0; i < count; i++)
+                    current_scope << (i > 0 ? ", " : " ") << "\"" << en->values[i].val.value() << "\"";
+                current_scope << " };\n";
+                current_scope << indentation << "  return os << names[static_cast<std::size_t>(v)];\n";
+                current_scope << indentation << "}\n";
+            }
+
+            void operator()(const Node::StructDeclaration* st) const {
+                const std::string name = st->ident.val.value();
+
+                current_scope << "\n";
+                current_scope << indentation << "struct " << name << " {\n";
+                for (const Node::Field* f : st->fields)
+                    current_scope << indentation << "  " << type(f->type) << " " << f->ident.val.value() << "{};\n";
+                current_scope << indentation << "};\n";
+
+                // the same fields, one array each, for `Name[N] @soa`
+                include("<array>");
+                include("\"cern/array.hpp\"");
+
+                current_scope << "\n";
+                current_scope << indentation << "template <std::size_t N>\n";
+                current_scope << indentation << "struct " << name << "_soa {\n";
+                for (const Node::Field* f : st->fields)
+                    current_scope << indentation << "  std::array<" << type(f->type) << ", N> " << f->ident.val.value() << "{};\n";
+                current_scope << indentation << "};\n";
+            }
+
             void operator()(const Node::FuncDeclaration* func) const {
+                trace::Span span("gen func", func->ident.val.value());
+
                 current_scope << "\n";
                 current_scope << indentation;
-                current_scope << to_string(func->type);
+                current_scope << type(func->type);
                 current_scope << " ";
                 current_scope << func->ident.val.value();
-                current_scope << "()\n";
+                current_scope << "(";
+
+                for (size_t i = 0; i < func->params.size(); i++) {
+                    if (i > 0)
+                        current_scope << ", ";
+                    current_scope << param(func->params[i]);
+                }
+
+                // a function of an imported module is only declared
+                if (func->scope == nullptr) {
+                    current_scope << ");\n";
+                    return;
+                }
+
+                current_scope << ")\n";
                 scope(func->scope);
             }
         };
@@ -118,7 +371,7 @@ namespace gen {
 
             void operator()(const Node::StmtImplicitVar* stmt_var) const {
                 current_scope << indentation;
-                current_scope << to_string(stmt_var->expr->type);
+                current_scope << type(stmt_var->type);
                 current_scope << " ";
                 current_scope << stmt_var->identifier.val.value();
                 current_scope << " = ";
@@ -128,12 +381,23 @@ namespace gen {
 
             void operator()(const Node::StmtExplicitVar* stmt_var) const {
                 current_scope << indentation;
-                current_scope << to_string(stmt_var->type);
+                current_scope << type(stmt_var->type);
                 current_scope << " ";
                 current_scope << stmt_var->ident.val.value();
+                if (stmt_var->type.kind == VarType::ARRAY || stmt_var->type.kind == VarType::ENUM)
+                    current_scope << "{}";
+                else if (stmt_var->frame)
+                    current_scope << "(cern::frame_arena())";
                 current_scope << ";\n";
             }
 
+            // array sizes and match cases use the value of the constant, it may never be named
+            void operator()(const Node::StmtConst* stmt_const) const {
+                current_scope << indentation;
+                current_scope << "[[maybe_unused]] constexpr " << type(stmt_const->type) << " " << stmt_const->ident.val.value();
+                current_scope << " = " << expr(stmt_const->expr) << ";\n";
+            }
+
             void operator()(const Node::StmtVarAssign* var_assign) const {
                 current_scope << indentation;
                 current_scope << var_assign->ident.val.value();
@@ -142,10 +406,19 @@ namespace gen {
                 current_scope << ";\n";
             }
 
+            void operator()(const Node::StmtElemAssign* elem_assign) const {
+                current_scope << indentation;
+                current_scope << term(elem_assign->target);
+                current_scope << " = ";
+                current_scope << expr(elem_assign->expr);
+                current_scope << ";\n";
+            }
+
             void operator()(const Node::FuncCall* fcall) const {
-                if (const auto f = call_func(fcall->ident.val.value(), fcall->args)) {
+                if (const auto f = call_func(fcall)) {
                     current_scope << indentation;
                     current_scope << f.value();
+                    current_scope << ";\n";
                     return;
                 }
 
@@ -188,6 +461,126 @@ namespace gen {
                 scope(w->scope);
             }
 
+            void operator()(const Node::StmtFor* f) const {
+                const std::string i = f->ident.val.value();
+
+                const std::string t = type(f->range->type);
+
+                // the end is read once into a local, so the trip count is known before the first iteration
+                // and stores in the body cannot change it
+                if (!f->step.has_value()) {
+                    current_scope << indentation;
+                    current_scope << "for (" << t << " " << i << " = " << expr(f->range->begin);
+                    current_scope << ", cern_end = " << expr(f->range->end) << "; " << i << " < cern_end; " << i << "++)\n";
+                    scope(f->scope);
+                    return;
+                }
+
+                // with a step, i + step can pass the maximum of the type: the iterations are counted instead
+                include("\"cern/loop.hpp\"");
+
+                begin_scope();
+
+                current_scope << indentation << t << " " << i << " = " << expr(f->range->begin) << ";\n";
+                current_scope << indentation << "const " << t << " cern_end = " << expr(f->range->end) << ";\n";
+                current_scope << indentation << "const " << t << " cern_step = cern::for_step<" << t << ">(" << expr(f->step.value()) << ", " << f->ident.line << ");\n";
+                current_scope << indentation << "for (auto cern_n = cern::trip_count(" << i << ", cern_end, cern_step); cern_n > 0; cern_n--, " << i << " = cern::advance(" << i << ", cern_step))\n";
+                scope(f->scope);
+
+                end_scope();
+            }
+
+            void operator()(const Node::StmtParallelFor* pfor) const {
+                include("\"cern/parallel.hpp\"");
+
+                const std::string i = pfor->ident.val.value();
+                const std::string t = type(pfor->range->type);
+
+                // the runtime hands out chunks [cern_lo, cern_hi) of the range to its workers, in the type of the range
+                current_scope << indentation;
+                current_scope << "cern::parallel_for<" << t << ">(";
+                current_scope << expr(pfor->range->begin) << ", ";
+                current_scope << expr(pfor->range->end) << ", ";
+                current_scope << (pfor->grain.has_value() ? expr(pfor->grain.value()) : "0");
+                current_scope << ", [&](" << t << " cern_lo, " << t << " cern_hi) {\n";
+
+                indentation += "  ";
+                current_scope << indentation;
+                current_scope << "for (" << t << " " << i << " = cern_lo; " << i << " < cern_hi; " << i << "++)\n";
+                scope(pfor->scope);
+                indentation.pop_back();
+                indentation.pop_back();
+
+                current_scope << indentation << "});\n";
+            }
+
+            // the frame is declared first so it is destroyed last, after the lists it holds
+            void operator()(const Node::StmtFrame* f) const {
+                include("\"cern/arena.hpp\"");
+
+                begin_scope();
+
+                current_scope << indentation << "cern::frame cern_frame;\n";
+                for (const Node::ScopeStmt* s : f->scope->stmts)
+                    scope_stmt(s);
+
+                end_scope();
+            }
+
+            // the body is a lambda so the runtime can call it once per run
+            void operator()(const Node::StmtBench* b) const {
+                include("\"cern/bench.hpp\"");
+
+                current_scope << indentation;
+                current_scope << "cern::bench(" << expr(b->name) << ", ";
+                current_scope << (b->runs.has_value() ? expr(b->runs.value()) : "100");
+                current_scope << ", [&]() {\n";
+
+                indentation += "  ";
+                scope(b->scope);
+                indentation.pop_back();
+                indentation.pop_back();
+
+                current_scope << indentation << "});\n";
+            }
+
+            // a switch lets the backend pick a jump table, a bit test or a lookup table for dense cases
+            void operator()(const Node::StmtMatch* m) const {
+                const VarType& t = m->expr->type;
+
+                current_scope << indentation;
+                current_scope << "switch (" << expr(m->expr) << ")\n";
+                current_scope << indentation << "{\n";
+
+                for (const Node::MatchArm* arm : m->arms) {
+                    if (arm->cases.empty())
+                        current_scope << indentation << "default:\n";
+
+                    // gcc and clang case ranges, bounds included
+                    for (const Node::MatchCase& c : arm->cases) {
+                        current_scope << indentation << "case " << match_value(t, c.first);
+                        if (c.last != c.first)
+                            current_scope << " ... " << match_value(t, c.last);
+                        current_scope << ":\n";
+                    }
+
+                    indentation += "  ";
+                    scope(arm->scope);
+                    current_scope << indentation << "break;\n";
+                    indentation.pop_back();
+                    indentation.pop_back();
+                }
+
+                // every value has a case, the backend can drop the range check of a jump table
+                if (!m->has_else) {
+                    include("<utility>");
+                    current_scope << indentation << "default:\n";
+                    current_scope << indentation << "  std::unreachable();\n";
+                }
+
+                current_scope << indentation << "}\n";
+            }
+
             void operator()(const Node::StmtIf* stmt_if) const {
                 current_scope << indentation;
                 current_scope << "if (";
@@ -204,6 +597,20 @@ namespace gen {
         std::visit(visitor, s->var);
     }
 
+    std::string match_value(const VarType& t, __int128 v) {
+        if (t.kind == VarType::ENUM)
+            return t.name + "::" + enums.at(t.name)->values[static_cast<size_t>(v)].val.value();
+        if (t.kind == VarType::CHAR && v >= 0 && std::isalnum(static_cast<int>(v)))
+            return "'" + std::string(1, static_cast<char>(v)) + "'";
+        // the minimum of i64 has no literal, its opposite does not fit
+        if (t.bits() == 64 && v == std::numeric_limits<long long>::min())
+            return "(-9223372036854775807LL - 1)";
+        const std::string value = v < 0 ? std::to_string(static_cast<long long>(v)) : std::to_string(static_cast<unsigned long long>(v));
+        if (t.bits() == 64)
+            return value + (t.is_unsigned() ? "ULL" : "LL");
+        return value;
+    }
+
     void if_pred(const Node::IfPred* pred) {
         struct PredVisitor {
             void operator()(const Node::IfPredElif* elif_pred) const {
@@ -244,6 +651,10 @@ namespace gen {
                 result = "!" + expr(e->expr);
             }
 
+            void operator()(const Node::ExprBitNot* e) {
+                result = "~" + expr(e->expr);
+            }
+
             void operator()(const Node::VarIncr* i) {
                 result = i->ident->ident.val.value() + "++";
             }
@@ -256,63 +667,96 @@ namespace gen {
         ExprVisitor visitor;
         std::visit(visitor, e->var);
 
+        // c++ computes on at least an int, truncate the result to the cern type
+        if (narrowed(e))
+            return "static_cast<" + type(e->type) + ">(" + visitor.result + ")";
+
         return visitor.result;
     }
 
     std::string bin_expr(const Node::BinExpr* bin) {
         struct BinExprVisitor {
+            TokenType op;
             std::string result;
 
+            std::string join(const Node::Expr* lside, const std::string& text, const Node::Expr* rside) const {
+                return operand(lside, rside, op, false) + " " + text + " " + operand(rside, lside, op, true);
+            }
+
             void operator()(const Node::BinExprAdd* add) {
-                result = expr(add->lside) + " + " + expr(add->rside);
+                result = join(add->lside, "+", add->rside);
             }
 
             void operator()(const Node::BinExprSub* sub) {
-                result = expr(sub->lside) + " - " + expr(sub->rside);
+                result = join(sub->lside, "-", sub->rside);
             }
 
             void operator()(const Node::BinExprMulti* multi) {
-                result = expr(multi->lside) + " * " + expr(multi->rside);
+                result = join(multi->lside, "*", multi->rside);
             }
 
             void operator()(const Node::BinExprDiv* div) {
-                result = expr(div->lside) + " / " + expr(div->rside);
+                result = join(div->lside, "/", div->rside);
+            }
+
+            void operator()(const Node::BinExprMod* mod) {
+                result = join(mod->lside, "%", mod->rside);
+            }
+
+            void operator()(const Node::BinExprBitAnd* e) {
+                result = join(e->lside, "&", e->rside);
+            }
+
+            void operator()(const Node::BinExprBitOr* e) {
+                result = join(e->lside, "|", e->rside);
+            }
+
+            void operator()(const Node::BinExprBitXor* e) {
+                result = join(e->lside, "^", e->rside);
+            }
+
+            void operator()(const Node::BinExprShl* e) {
+                result = join(e->lside, "<<", e->rside);
+            }
+
+            void operator()(const Node::BinExprShr* e) {
+                result = join(e->lside, ">>", e->rside);
             }
 
             void operator()(const Node::BinExprAnd* e) {
-                result = expr(e->lside) + " && " + expr(e->rside);
+                result = join(e->lside, "&&", e->rside);
             }
 
             void operator()(const Node::BinExprOr* e) {
-                result = expr(e->lside) + " || " + expr(e->rside);
+                result = join(e->lside, "||", e->rside);
             }
 
             void operator()(const Node::BinExprIsEqual* e) {
-                result = expr(e->lside) + " == " + expr(e->rside);
+                result = join(e->lside, "==", e->rside);
             }
 
             void operator()(const Node::BinExprIsNotEqual* e) {
-                result = expr(e->lside) + " != " + expr(e->rside);
+                result = join(e->lside, "!=", e->rside);
             }
 
             void operator()(const Node::BinExprGreaterOrEqual* e) {
-                result = expr(e->lside) + " >= " + expr(e->rside);
+                result = join(e->lside, ">=", e->rside);
             }
 
             void operator()(const Node::BinExprGreater* e) {
-                result = expr(e->lside) + " > " + expr(e->rside);
+                result = join(e->lside, ">", e->rside);
             }
 
             void operator()(const Node::BinExprLowerOrEqual* e) {
-                result = expr(e->lside) + " <= " + expr(e->rside);
+                result = join(e->lside, "<=", e->rside);
             }
 
             void operator()(const Node::BinExprLower* e) {
-                result = expr(e->lside) + " < " + expr(e->rside);
+                result = join(e->lside, "<", e->rside);
             }
         };
 
-        BinExprVisitor visitor;
+        BinExprVisitor visitor{ .op = bin->op };
         std::visit(visitor, bin->var);
 
         return visitor.result;
@@ -330,12 +774,16 @@ namespace gen {
                 result = term_int_lit->int_lit.val.value();
             }
 
+            void operator()(const Node::TermFloatLiteral* term_float_lit) {
+                result = term_float_lit->float_lit.val.value();
+            }
+
             void operator()(const Node::TermCharLiteral* term_char_lit) {
                 result = "'" + term_char_lit->char_lit.val.value() + "'";
             }
 
             void operator()(const Node::TermStringLiteral* term_string_lit) {
-                result = "\"" + term_string_lit->string_lit.val.value() + "\"";
+                result = literal(term_string_lit->string_lit.val.value());
             }
 
             void operator()(const Node::TermIdentifier* term_ident) {
@@ -343,7 +791,7 @@ namespace gen {
             }
 
             void operator()(const Node::FuncCall* fcall) {
-                if (const auto f = call_func(fcall->ident.val.value(), fcall->args)) {
+                if (const auto f = call_func(fcall)) {
                     result = f.value();
                     return;
                 }
@@ -366,11 +814,88 @@ namespace gen {
             void operator()(const Node::TermParen* term_paren) {
                 result = "(" + expr(term_paren->expr) + ")";
             }
+
+            void operator()(const Node::TermEnumValue* enum_value) {
+                result = enum_value->ident.val.value() + "::" + enum_value->value.val.value();
+            }
+
+            void operator()(const Node::TermConstruct* construct) {
+                const std::string t = type(construct->type);
+
+                if (construct->type.kind == VarType::STRUCT) {
+                    result = t + "{ ";
+                    for (size_t i = 0; i < construct->args.size(); i++) {
+                        if (i > 0)
+                            result += ", ";
+                        result += expr(construct->args[i]);
+                    }
+                    result += " }";
+                    return;
+                }
+
+                if (!construct->type.is_vector()) {
+                    result = "static_cast<" + t + ">(" + expr(construct->args[0]) + ")";
+                    return;
+                }
+
+                if (construct->args.size() == 1) {
+                    result = "cern::splat<" + t + ", " + std::to_string(construct->type.lanes()) + ">(" + as_float(construct->args[0]) + ")";
+                    return;
+                }
+
+                result = t + "{ ";
+                for (size_t i = 0; i < construct->args.size(); i++) {
+                    if (i > 0)
+                        result += ", ";
+                    result += as_float(construct->args[i]);
+                }
+                result += " }";
+            }
+
+            void operator()(const Node::TermField* term_field) {
+                const std::string& field = term_field->field.val.value();
+
+                // vectors components are lanes: x, y, z, w
+                if (term_field->base->type.is_vector()) {
+                    const size_t lane = std::string("xyzw").find(field);
+                    result = term(term_field->base) + "[" + std::to_string(lane) + "]";
+                    return;
+                }
+
+                // ps[i].pos of an @soa array reads ps.pos[i]
+                if (const auto index = std::get_if<Node::TermIndex*>(&term_field->base->var)) {
+                    if ((*index)->base->type.soa) {
+                        result = "cern::at(" + term((*index)->base) + "." + field + ", " + expr((*index)->index) + ", " + std::to_string((*index)->line) + ")";
+                        return;
+                    }
+                }
+
+                result = term(term_field->base) + "." + field;
+            }
+
+            void operator()(const Node::TermIndex* term_index) {
+                if (term_index->base->type.kind == VarType::STRING || term_index->base->type.kind == VarType::STR_VIEW)
+                    include("\"cern/str.hpp\"");
+                result = "cern::at(" + term(term_index->base) + ", " + expr(term_index->index) + ", " + std::to_string(term_index->line) + ")";
+            }
+
+            void operator()(const Node::TermSlice* slice) {
+                include("\"cern/str.hpp\"");
+                result = "cern::slice(" + term(slice->base) + ", " + expr(slice->begin) + ", " + expr(slice->end) + ", " + std::to_string(slice->line) + ")";
+            }
         };
 
         TermVisitor visitor;
         std::visit(visitor, t->var);
 
+        // literals that do not fit in an int
+        if (std::holds_alternative<Node::TermIntegerLiteral*>(t->var) && t->type.bits() == 64)
+            return visitor.result + (t->type.is_unsigned() ? "ULL" : "LL");
+
         return visitor.result;
     }
+
+    size_t buffered_bytes() {
+        return output.view().size() + current_scope.view().size();
+    }
 }
@@ -3,13 +3,39 @@
 #include "parser.h"
 
 namespace gen {
+    // name of the type in the generated c++ (ex: std::array<int, 16>)
+    std::string type(const VarType& t);
+
+    // declaration of a function parameter: scalars by value, other types by const reference, `ref` by reference
+    std::string param(const Node::Param* p);
+
+    // include a header in the generated code (ex: "cern/array.hpp" or <vector>)
+    void include(const std::string& header);
+
+    // expression converted to float, as expected by vectors components
+    std::string as_float(const Node::Expr* e);
+
+    // true if the expression is emitted inside a static_cast to its narrow integer type
+    bool narrowed(const Node::Expr* e);
+
+    // precedence of a binary operator in c++, higher binds tighter
+    int cpp_prec(TokenType op);
+
+    // operand of the binary operator `op` (`other` is the other operand, `right` its side):
+    // parenthesized where c++ would group it differently, and converted to float next to a vector
+    std::string operand(const Node::Expr* e, const Node::Expr* other, TokenType op, bool right);
+
+    // value of a match case as a c++ constant of the matched type
+    std::string match_value(const VarType& t, __int128 v);
+
     void begin_scope();
 
     void end_scope();
 
     void exit_with(const std::string &err_msg);
 
-    std::string prog(const Node::Prog p);
+    // c++ of a program, or of an imported module (its globals are private to it and it has no main)
+    std::string prog(const Node::Prog p, bool module = false);
 
     void prog_stmt(const Node::ProgStmt *s);
 
@@ -24,4 +50,7 @@ namespace gen {
     std::string bin_expr(const Node::BinExpr *bin);
 
     std::string term(const Node::Term *t);
+
+    // bytes currently held by the generator's buffers
+    size_t buffered_bytes();
 }
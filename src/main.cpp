@@ -1,30 +1,373 @@
 #include <iostream>
 #include <fstream>
+#include <cstdlib>
 #include <sstream>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <deque>
+#include <new>
 
 #include "generation.h"
+#include "module.h"
+#include "trace.h"
+#include "perf.h"
+#include "memory.h"
+
+#ifndef CERN_RUNTIME_DIR
+#define CERN_RUNTIME_DIR "runtime"
+#endif
+
+namespace
+{
+    struct Options
+    {
+        std::string input;
+        std::string output = "app";
+        // c++ compiler used to build the generated code
+        std::string backend = "g++";
+        // debug or release
+        std::string profile = "debug";
+        // check array indices at runtime, defaults to on in debug and off in release
+        std::optional<bool> bounds_check;
+        // chrome trace-event file, empty if not requested
+        std::string trace;
+        bool time_passes = false;
+        bool perf_counters = false;
+        bool mem_report = false;
+    };
+
+    struct PhaseStats
+    {
+        std::string name;
+        double ms;
+        perf::Sample counters{};
+        // amount of work done by the phase (ex: tokens produced) and its name, 0 if meaningless
+        size_t units = 0;
+        std::string unit{};
+        // heap bytes live when the phase started / ended, and the highest value in between
+        size_t live_before = 0;
+        size_t live_after = 0;
+        size_t peak = 0;
+        // growth of the peak resident set size of the process during the phase
+        size_t rss_delta = 0;
+    };
+
+    // bytes held by each data structure of the pipeline, filled by --mem-report
+    struct MemoryBreakdown
+    {
+        size_t source = 0;
+        size_t tokens = 0;
+        size_t arena_used = 0;
+        size_t arena_capacity = 0;
+        size_t generator = 0;
+        size_t output = 0;
+    };
+
+    std::deque<PhaseStats> phases;
+
+    // opened by --perf-counters
+    std::unique_ptr<perf::Counters> counters;
+
+    // run one phase of the compilation, recording it in the trace, the pass timings and the counters
+    // (the returned stats stay valid, phases is a deque)
+    template <typename F>
+    PhaseStats &phase(const std::string &name, F &&f)
+    {
+        trace::Span span(name);
+        const size_t live_before = mem::live_bytes();
+        const size_t rss_before = mem::peak_rss();
+        mem::reset_peak();
+        if (counters)
+            counters->start();
+        const auto start = std::chrono::steady_clock::now();
+
+        f();
+
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        phases.push_back({name, elapsed.count()});
+        if (counters)
+            phases.back().counters = counters->stop();
+
+        PhaseStats &stats = phases.back();
+        stats.live_before = live_before;
+        stats.live_after = mem::live_bytes();
+        stats.peak = mem::peak_bytes();
+        stats.rss_delta = mem::peak_rss() - rss_before;
+
+        return stats;
+    }
+
+    void print_phase_times()
+    {
+        double total = 0;
+        for (const PhaseStats &p : phases)
+            total += p.ms;
+
+        std::cerr << "===== pass timings =====" << std::endl;
+        for (const PhaseStats &p : phases)
+        {
+            std::cerr << std::left << std::setw(12) << p.name
+                      << std::right << std::fixed << std::setprecision(3) << std::setw(12) << p.ms << " ms"
+                      << std::setw(8) << std::setprecision(1) << (total > 0 ? 100 * p.ms / total : 0) << " %" << std::endl;
+        }
+        std::cerr << std::left << std::setw(12) << "total"
+                  << std::right << std::setprecision(3) << std::setw(12) << total << " ms" << std::endl;
+    }
+
+    std::string format_count(const std::optional<uint64_t> &v)
+    {
+        return v.has_value() ? std::to_string(v.value()) : "-";
+    }
+
+    std::string format_ratio(const std::optional<uint64_t> &num, const std::optional<double> &den)
+    {
+        if (!num.has_value() || !den.has_value() || den.value() == 0)
+            return "-";
+
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3) << num.value() / den.value();
+        return ss.str();
+    }
+
+    void print_perf_counters()
+    {
+        std::cerr << "===== hardware counters =====" << std::endl;
+
+        std::cerr << std::left << std::setw(12) << "phase" << std::right;
+        for (int c = 0; c < perf::COUNTER_COUNT; c++)
+            std::cerr << std::setw(16) << perf::to_string(static_cast<perf::Counter>(c));
+        std::cerr << std::setw(8) << "IPC" << std::endl;
+
+        for (const PhaseStats &p : phases)
+        {
+            std::cerr << std::left << std::setw(12) << p.name << std::right;
+            for (const auto &v : p.counters)
+                std::cerr << std::setw(16) << format_count(v);
+
+            std::optional<double> cycles;
+            if (p.counters[perf::CYCLES].has_value())
+                cycles = p.counters[perf::CYCLES].value();
+            std::cerr << std::setw(8) << format_ratio(p.counters[perf::INSTRUCTIONS], cycles) << std::endl;
+        }
+
+        std::cerr << std::endl
+                  << std::left << std::setw(20) << "per unit of work" << std::right;
+        for (const perf::Counter c : {perf::INSTRUCTIONS, perf::BRANCH_MISSES, perf::L1D_MISSES, perf::LLC_MISSES})
+            std::cerr << std::setw(16) << perf::to_string(c);
+        std::cerr << std::endl;
+
+        for (const PhaseStats &p : phases)
+        {
+            if (p.units == 0)
+                continue;
+
+            const std::optional<double> units = p.units;
+            std::cerr << std::left << std::setw(20) << (p.name + "/" + p.unit) << std::right;
+            for (const perf::Counter c : {perf::INSTRUCTIONS, perf::BRANCH_MISSES, perf::L1D_MISSES, perf::LLC_MISSES})
+                std::cerr << std::setw(16) << format_ratio(p.counters[c], units);
+            std::cerr << std::endl;
+        }
+    }
+
+    std::string format_bytes(size_t bytes)
+    {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1);
+
+        if (bytes >= 1024 * 1024)
+            ss << bytes / (1024.0 * 1024.0) << " MB";
+        else if (bytes >= 1024)
+            ss << bytes / 1024.0 << " KB";
+        else
+            ss << bytes << " B";
+
+        return ss.str();
+    }
+
+    void print_mem_report(const MemoryBreakdown &breakdown)
+    {
+        std::cerr << "===== memory =====" << std::endl;
+
+        if (!mem::available())
+            std::cerr << "[Warning] heap accounting is not supported on this platform, heap columns are 0" << std::endl;
+
+        std::cerr << std::left << std::setw(12) << "phase" << std::right
+                  << std::setw(14) << "live before" << std::setw(14) << "live after"
+                  << std::setw(14) << "peak" << std::setw(14) << "peak delta" << std::setw(14) << "RSS delta" << std::endl;
+
+        for (const PhaseStats &p : phases)
+        {
+            std::cerr << std::left << std::setw(12) << p.name << std::right
+                      << std::setw(14) << format_bytes(p.live_before)
+                      << std::setw(14) << format_bytes(p.live_after)
+                      << std::setw(14) << format_bytes(p.peak)
+                      << std::setw(14) << format_bytes(p.peak - p.live_before)
+                      << std::setw(14) << format_bytes(p.rss_delta) << std::endl;
+        }
+
+        std::cerr << std::endl;
+        std::cerr << std::left << std::setw(24) << "source text" << std::right << std::setw(14) << format_bytes(breakdown.source)
+                  << "  (copied once more into the tokenizer)" << std::endl;
+        std::cerr << std::left << std::setw(24) << "token vector" << std::right << std::setw(14) << format_bytes(breakdown.tokens) << std::endl;
+        std::cerr << std::left << std::setw(24) << "AST arena" << std::right << std::setw(14) << format_bytes(breakdown.arena_used)
+                  << "  of " << format_bytes(breakdown.arena_capacity) << " reserved" << std::endl;
+        std::cerr << std::left << std::setw(24) << "generator stringstreams" << std::right << std::setw(14) << format_bytes(breakdown.generator) << std::endl;
+        std::cerr << std::left << std::setw(24) << "generated c++" << std::right << std::setw(14) << format_bytes(breakdown.output) << std::endl;
+        std::cerr << std::left << std::setw(24) << "heap allocations" << std::right << std::setw(14) << mem::allocations() << std::endl;
+        std::cerr << std::left << std::setw(24) << "peak RSS" << std::right << std::setw(14) << format_bytes(mem::peak_rss()) << std::endl;
+    }
+
+    // heap bytes owned by a token vector, strings included
+    size_t token_bytes(const std::vector<Token> &tokens)
+    {
+        size_t bytes = tokens.capacity() * sizeof(Token);
+
+        for (const Token &t : tokens)
+            if (t.val.has_value() && t.val.value().capacity() > std::string().capacity())
+                bytes += t.val.value().capacity() + 1;
+
+        return bytes;
+    }
+
+    void usage()
+    {
+        std::cerr << "usage: cern [options] <file.ce>\n"
+                  << "  -o <file>                  name of the executable (default app)\n"
+                  << "  --backend=<compiler>       c++ compiler used for the generated code (default g++)\n"
+                  << "  --profile=<debug|release>  build profile of the generated code (default debug)\n"
+                  << "  --bounds-check=<on|off>    check array indices at runtime (default on in debug, off in release)\n"
+                  << "  --time-passes              print the time spent in each phase\n"
+                  << "  --trace=<file.json>        record the phases in chrome trace-event format\n"
+                  << "  --perf-counters            read the hardware counters of each phase\n"
+                  << "  --mem-report               print the heap and RSS used by each phase" << std::endl;
+    }
+
+    std::string profile_flags(const Options &opt)
+    {
+        std::string flags = opt.profile == "release" ? "-O2 -DNDEBUG" : "-O0 -g";
+
+        if (opt.bounds_check.value_or(opt.profile == "debug"))
+            flags += " -DCERN_BOUNDS_CHECK";
+
+        return flags;
+    }
+
+    // directory holding the headers of the runtime used by the generated code
+    std::string runtime_dir()
+    {
+        if (const char *dir = std::getenv("CERN_RUNTIME_DIR"))
+            return dir;
+        return CERN_RUNTIME_DIR;
+    }
+}
 
 int main(int argc, char *argv[])
 {
-    if (argc != 2)
+    // a program too large for the memory of the machine is an error, not a crash
+    std::set_new_handler([]
     {
-        std::cerr << "usage: cern <file.ce>" << std::endl;
+        std::cerr << "[Error] out of memory" << std::endl;
+        std::exit(EXIT_FAILURE);
+    });
+
+    Options opt;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+
+        if (arg == "-o" && i + 1 < argc)
+            opt.output = argv[++i];
+        else if (arg.starts_with("--backend="))
+            opt.backend = arg.substr(std::string("--backend=").size());
+        else if (arg.starts_with("--profile="))
+            opt.profile = arg.substr(std::string("--profile=").size());
+        else if (arg == "--bounds-check=on" || arg == "--bounds-check=off")
+            opt.bounds_check = arg == "--bounds-check=on";
+        else if (arg.starts_with("--trace="))
+            opt.trace = arg.substr(std::string("--trace=").size());
+        else if (arg == "--time-passes")
+            opt.time_passes = true;
+        else if (arg == "--perf-counters")
+            opt.perf_counters = true;
+        else if (arg == "--mem-report")
+            opt.mem_report = true;
+        else if (!arg.starts_with("-") && opt.input.empty())
+            opt.input = arg;
+        else
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (opt.input.empty() || (opt.profile != "debug" && opt.profile != "release"))
+    {
+        usage();
         return EXIT_FAILURE;
     }
 
+    if (!opt.trace.empty())
+        trace::enable(opt.trace);
+
+    if (opt.perf_counters)
+    {
+        counters = std::make_unique<perf::Counters>();
+
+        if (!counters->available())
+        {
+            std::cerr << "[Warning] hardware counters unavailable (" << counters->error() << "), --perf-counters ignored" << std::endl;
+            counters.reset();
+        }
+        else if (!counters->error().empty())
+            std::cerr << "[Warning] some hardware counters are unavailable (" << counters->error() << ")" << std::endl;
+    }
+
+    MemoryBreakdown breakdown;
+
     std::string contents;
+    phase("read", [&]
     {
-        std::ifstream infile(argv[1]);
+        std::ifstream infile(opt.input);
         std::stringstream content_stream;
         content_stream << infile.rdbuf();
         contents = content_stream.str();
-    }
+    });
+    breakdown.source = contents.capacity();
+
+    std::vector<Token> tokens;
+    PhaseStats &tokenize = phase("tokenize", [&]
+    {
+        Tokenizer tokenizer(std::move(contents));
+        tokens = tokenizer.tokenize();
+    });
+    tokenize.units = tokens.size();
+    tokenize.unit = "token";
+    breakdown.tokens = token_bytes(tokens);
 
-    Tokenizer tokenizer(std::move(contents));
-    std::vector<Token> tokens = tokenizer.tokenize();
+    // -pthread for the thread pool behind `parallel for`
+    const std::string cxx = opt.backend + " -std=c++23 -Wall -Wextra -pthread " + profile_flags(opt) + " -I" + runtime_dir();
 
-    Parser parser(std::move(tokens));
-    std::optional<Node::Prog> prog = parser.parse_prog();
+    // every imported module is compiled (or found in .cern-cache/) before the program is parsed
+    std::unordered_map<std::string, const module::Interface *> imports;
+    phase("modules", [&]
+    {
+        imports = module::build_imports(opt.input, tokens, cxx + " -c");
+    });
+
+    // constructed inside the parse phase so that the arena is accounted to it
+    std::optional<Parser> parser;
+    std::optional<Node::Prog> prog;
+    PhaseStats &parse = phase("parse", [&]
+    {
+        parser.emplace(std::move(tokens), std::move(imports));
+        prog = parser->parse_prog();
+    });
+    parse.units = parser->node_count();
+    parse.unit = "node";
+    breakdown.arena_used = parser->arena().used();
+    breakdown.arena_capacity = parser->arena().capacity();
 
     if (!prog.has_value())
     {
@@ -32,13 +375,44 @@ int main(int argc, char *argv[])
         exit(EXIT_FAILURE);
     }
 
+    PhaseStats &generate = phase("generate", [&]
     {
+        const std::string code = gen::prog(std::move(prog.value()));
+        breakdown.generator = gen::buffered_bytes();
+        breakdown.output = code.size();
+
         std::ofstream outfile("main.cpp");
-        outfile << gen::prog(std::move(prog.value()));
-    }
+        outfile << code;
+    });
+    generate.units = parser->node_count();
+    generate.unit = "node";
+
+    // linked with the object files of the modules
+    std::string command = cxx + " main.cpp";
+    for (const std::string &object : module::objects())
+        command += " " + object;
+    command += " -o " + opt.output;
+
+    int status = 0;
+    phase("backend", [&]
+    {
+        status = system(command.c_str());
+    });
 
-    //system("g++ -std=c++23 main.cpp -o app");
-    system("g++ -std=c++23 -Wall -Wextra main.cpp -o app"); // to remove
+    if (opt.time_passes)
+        print_phase_times();
+
+    if (counters)
+        print_perf_counters();
+
+    if (opt.mem_report)
+        print_mem_report(breakdown);
+
+    if (!trace::write())
+        std::cerr << "[Warning] could not write the trace to " << opt.trace << std::endl;
+
+    if (status != 0)
+        return EXIT_FAILURE;
 
     return EXIT_SUCCESS;
 }
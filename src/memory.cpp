@@ -0,0 +1,144 @@
+#include "memory.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+namespace mem {
+    namespace {
+        std::atomic<size_t> live{ 0 };
+        std::atomic<size_t> peak{ 0 };
+        std::atomic<size_t> count{ 0 };
+
+        size_t block_size(void* p) {
+#ifdef __GLIBC__
+            return malloc_usable_size(p);
+#else
+            (void)p;
+            return 0;
+#endif
+        }
+
+        void* allocate(size_t size) {
+            void* p = std::malloc(size == 0 ? 1 : size);
+            if (p == nullptr)
+                return nullptr;
+
+            const size_t size_used = block_size(p);
+            const size_t now = live.fetch_add(size_used, std::memory_order_relaxed) + size_used;
+            count.fetch_add(1, std::memory_order_relaxed);
+
+            size_t prev = peak.load(std::memory_order_relaxed);
+            while (now > prev && !peak.compare_exchange_weak(prev, now, std::memory_order_relaxed));
+
+            return p;
+        }
+
+        // like the standard operator new, call the new handler until it frees memory or gives up
+        void* allocate_or_throw(size_t size) {
+            while (true) {
+                if (void* p = allocate(size))
+                    return p;
+
+                const std::new_handler handler = std::get_new_handler();
+                if (handler == nullptr)
+                    throw std::bad_alloc{};
+                handler();
+            }
+        }
+
+        void deallocate(void* p) {
+            if (p == nullptr)
+                return;
+
+            live.fetch_sub(block_size(p), std::memory_order_relaxed);
+            std::free(p);
+        }
+    }
+
+    bool available() {
+#ifdef __GLIBC__
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    size_t live_bytes() {
+        return live.load(std::memory_order_relaxed);
+    }
+
+    size_t peak_bytes() {
+        return peak.load(std::memory_order_relaxed);
+    }
+
+    void reset_peak() {
+        peak.store(live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    size_t allocations() {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    size_t peak_rss() {
+#ifdef __unix__
+        rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+        // kilobytes on linux
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#else
+        return 0;
+#endif
+    }
+}
+
+/* ----- COUNTING GLOBAL ALLOCATOR ----- */
+
+void* operator new(size_t size) {
+    return mem::allocate_or_throw(size);
+}
+
+void* operator new[](size_t size) {
+    return mem::allocate_or_throw(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return mem::allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return mem::allocate(size);
+}
+
+void operator delete(void* p) noexcept {
+    mem::deallocate(p);
+}
+
+void operator delete[](void* p) noexcept {
+    mem::deallocate(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    mem::deallocate(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    mem::deallocate(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    mem::deallocate(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    mem::deallocate(p);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+/// @brief heap accounting of the compiler, fed by a counting global operator new / delete
+namespace mem {
+    /// @return false if the heap cannot be accounted on this platform (every counter stays at 0)
+    bool available();
+
+    /// @return bytes currently allocated through operator new
+    size_t live_bytes();
+
+    /// @return highest value of live_bytes since the last call to reset_peak
+    size_t peak_bytes();
+
+    /// @brief start a new peak measurement from the current live bytes
+    void reset_peak();
+
+    /// @return number of calls to operator new so far
+    size_t allocations();
+
+    /// @return peak resident set size of the process in bytes (0 if unknown)
+    size_t peak_rss();
+}
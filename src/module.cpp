@@ -0,0 +1,633 @@
+#include "module.h"
+
+#include "generation.h"
+#include "trace.h"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CERN_HAS_MMAP
+#endif
+
+namespace module {
+    namespace {
+        namespace fs = std::filesystem;
+
+        const fs::path cache_dir = ".cern-cache";
+
+        // first bytes of an interface file, the last one is the version of the format
+        constexpr char magic[4] = { 'C', 'E', 'I', 1 };
+
+        enum class Tag : uint8_t {
+            STRUCT,
+            ENUM,
+            CONST,
+            FUNC
+        };
+
+        // modules built or loaded so far, by canonical path
+        std::unordered_map<std::string, const Interface*> built;
+        // every interface loaded, by key
+        std::unordered_map<uint64_t, std::unique_ptr<Interface>> loaded;
+        // modules being built, to report an import cycle
+        std::unordered_set<std::string> building;
+
+        std::vector<std::string> object_files;
+
+        void exit_with(const std::string& err_msg) {
+            std::cerr << "[Error] " << err_msg << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        // 64 bits FNV-1a, enough to tell the versions of a source apart
+        uint64_t hash(std::string_view data, uint64_t h = 0xcbf29ce484222325ULL) {
+            for (const char c : data) {
+                h ^= static_cast<unsigned char>(c);
+                h *= 0x100000001b3ULL;
+            }
+            return h;
+        }
+
+        // hash of the compiler binary, so what an older cern generated is never reused
+        // (the build time where the binary cannot be read)
+        uint64_t compiler_key() {
+            static const uint64_t key = [] {
+                std::ifstream in("/proc/self/exe", std::ios::binary);
+                if (!in)
+                    return hash(__DATE__ " " __TIME__);
+
+                uint64_t h = hash("cern");
+                std::array<char, 1 << 16> buffer;
+                while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0)
+                    h = hash(std::string_view(buffer.data(), static_cast<size_t>(in.gcount())), h);
+                return h;
+            }();
+            return key;
+        }
+
+        std::string hex(uint64_t v) {
+            char buf[17];
+            std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(v));
+            return buf;
+        }
+
+        std::string to_string(__int128 v) {
+            if (v == 0)
+                return "0";
+
+            const bool negative = v < 0;
+            unsigned __int128 u = negative ? -static_cast<unsigned __int128>(v) : static_cast<unsigned __int128>(v);
+
+            std::string digits;
+            while (u > 0) {
+                digits.insert(digits.begin(), static_cast<char>('0' + static_cast<int>(u % 10)));
+                u /= 10;
+            }
+
+            return negative ? "-" + digits : digits;
+        }
+
+        // written in the byte order of the machine, the cache is not shared between machines
+        class Writer {
+        private:
+            std::string buf;
+
+        public:
+            template <typename T>
+            void raw(const T& v) {
+                buf.append(reinterpret_cast<const char*>(&v), sizeof(T));
+            }
+
+            void u8(uint8_t v) {
+                raw(v);
+            }
+
+            void u32(uint32_t v) {
+                raw(v);
+            }
+
+            void str(const std::string& s) {
+                u32(static_cast<uint32_t>(s.size()));
+                buf += s;
+            }
+
+            void type(const VarType& t) {
+                u8(static_cast<uint8_t>(t.kind));
+
+                switch (t.kind) {
+                case VarType::ARRAY:
+                    raw(static_cast<uint64_t>(t.size));
+                    u8(t.soa);
+                    type(*t.elem);
+                    break;
+                case VarType::LIST:
+                    type(*t.elem);
+                    break;
+                case VarType::MAP:
+                    type(*t.key);
+                    type(*t.elem);
+                    break;
+                case VarType::STRUCT:
+                case VarType::ENUM:
+                    str(t.name);
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            const std::string& bytes() const {
+                return buf;
+            }
+        };
+
+        // reads what Writer wrote, a truncated or corrupted file only clears `ok`
+        class Reader {
+        private:
+            const char* p;
+            const char* end;
+
+        public:
+            bool ok = true;
+
+            Reader(const char* data, size_t size)
+                : p(data), end(data + size) {
+            }
+
+            bool at_end() const {
+                return p == end;
+            }
+
+            template <typename T>
+            T raw() {
+                T v{};
+                if (static_cast<size_t>(end - p) < sizeof(T)) {
+                    ok = false;
+                    return v;
+                }
+                std::memcpy(&v, p, sizeof(T));
+                p += sizeof(T);
+                return v;
+            }
+
+            uint8_t u8() {
+                return raw<uint8_t>();
+            }
+
+            uint32_t u32() {
+                return raw<uint32_t>();
+            }
+
+            std::string str() {
+                const uint32_t size = u32();
+                if (static_cast<size_t>(end - p) < size) {
+                    ok = false;
+                    return {};
+                }
+                std::string s(p, size);
+                p += size;
+                return s;
+            }
+
+            VarType type(int depth = 0) {
+                const uint8_t kind = u8();
+                if (kind > VarType::STR_VIEW || depth > 64) {
+                    ok = false;
+                    return VarType::VOID;
+                }
+
+                VarType t(static_cast<VarType::Kind>(kind));
+                switch (t.kind) {
+                case VarType::ARRAY: {
+                    const size_t size = raw<uint64_t>();
+                    const bool soa = u8();
+                    t = VarType::array_of(type(depth + 1), size);
+                    t.soa = soa;
+                    break;
+                }
+                case VarType::LIST:
+                    t = VarType::list_of(type(depth + 1));
+                    break;
+                case VarType::MAP: {
+                    const VarType key = type(depth + 1);
+                    t = VarType::map_of(key, type(depth + 1));
+                    break;
+                }
+                case VarType::STRUCT:
+                case VarType::ENUM:
+                    t.name = str();
+                    break;
+                default:
+                    break;
+                }
+                return t;
+            }
+        };
+
+        // literal emitted for an imported constant
+        Node::Expr* literal(ArenaAllocator& allocator, const VarType& t, const Parser::ConstValue& value) {
+            Node::Term* term = nullptr;
+
+            if (t.kind == VarType::BOOL) {
+                const Token tok{ .type = TokenType::BOOLEAN_LITEARL, .line = 0, .val = std::get<__int128>(value) != 0 ? "true" : "false" };
+                term = allocator.emplace<Node::Term>(allocator.emplace<Node::TermBooleanLiteral>(tok));
+            }
+            else if (const auto i = std::get_if<__int128>(&value)) {
+                // the generator adds LL to the 64 bits literals, and -9223372036854775808 would not be one
+                std::string text = to_string(*i);
+                if (t.bits() == 64 && !t.is_unsigned() && *i == t.min())
+                    text = "-9223372036854775807 - 1";
+                const Token tok{ .type = TokenType::INTEGER_LITERAL, .line = 0, .val = text };
+                term = allocator.emplace<Node::Term>(allocator.emplace<Node::TermIntegerLiteral>(tok));
+            }
+            else {
+                const double d = std::get<double>(value);
+
+                char buf[64];
+                std::snprintf(buf, sizeof(buf), t.kind == VarType::FLOAT ? "%.9g" : "%.17g", d);
+
+                std::string text = buf;
+                if (std::isfinite(d) && text.find_first_of(".e") == std::string::npos)
+                    text += ".0";
+                if (t.kind == VarType::FLOAT)
+                    text += "f";
+
+                const Token tok{ .type = TokenType::FLOAT_LITERAL, .line = 0, .val = text };
+                term = allocator.emplace<Node::Term>(allocator.emplace<Node::TermFloatLiteral>(tok));
+            }
+
+            term->type = t;
+            return allocator.emplace<Node::Expr>(term, t);
+        }
+
+        std::string interface_bytes(uint64_t key, const std::vector<const Interface*>& imports, const Node::Prog& prog, const Parser& parser) {
+            Writer w;
+
+            w.raw(magic);
+            w.raw(key);
+
+            w.u32(static_cast<uint32_t>(imports.size()));
+            for (const Interface* m : imports)
+                w.raw(m->key);
+
+            // imports and globals are not exported
+            std::vector<const Node::ProgStmt*> exported;
+            for (const Node::ProgStmt* s : prog.stmts) {
+                if (!std::holds_alternative<Node::Import*>(s->var) && !std::holds_alternative<Node::StmtImplicitVar*>(s->var) &&
+                    !std::holds_alternative<Node::StmtExplicitVar*>(s->var))
+                    exported.push_back(s);
+            }
+
+            w.u32(static_cast<uint32_t>(exported.size()));
+            for (const Node::ProgStmt* s : exported) {
+                if (const auto st = std::get_if<Node::StructDeclaration*>(&s->var)) {
+                    w.u8(static_cast<uint8_t>(Tag::STRUCT));
+                    w.str((*st)->ident.val.value());
+                    w.u32(static_cast<uint32_t>((*st)->fields.size()));
+                    for (const Node::Field* f : (*st)->fields) {
+                        w.str(f->ident.val.value());
+                        w.type(f->type);
+                    }
+                }
+                else if (const auto en = std::get_if<Node::EnumDeclaration*>(&s->var)) {
+                    w.u8(static_cast<uint8_t>(Tag::ENUM));
+                    w.str((*en)->ident.val.value());
+                    w.u32(static_cast<uint32_t>((*en)->values.size()));
+                    for (const Token& v : (*en)->values)
+                        w.str(v.val.value());
+                }
+                else if (const auto c = std::get_if<Node::StmtConst*>(&s->var)) {
+                    const Parser::ConstValue value = parser.constant((*c)->ident.val.value()).value();
+
+                    w.u8(static_cast<uint8_t>(Tag::CONST));
+                    w.str((*c)->ident.val.value());
+                    w.type((*c)->type);
+                    if (const auto i = std::get_if<__int128>(&value)) {
+                        w.u8(0);
+                        w.raw(*i);
+                    }
+                    else {
+                        w.u8(1);
+                        w.raw(std::get<double>(value));
+                    }
+                }
+                else if (const auto func = std::get_if<Node::FuncDeclaration*>(&s->var)) {
+                    const std::string& name = (*func)->ident.val.value();
+
+                    w.u8(static_cast<uint8_t>(Tag::FUNC));
+                    w.str(name);
+                    w.type((*func)->type);
+                    w.u8(parser.writes_globals(name));
+                    w.u32(static_cast<uint32_t>((*func)->params.size()));
+                    for (const Node::Param* p : (*func)->params) {
+                        w.str(p->ident.val.value());
+                        w.u8(p->ref);
+                        w.type(p->type);
+                    }
+                }
+            }
+
+            return w.bytes();
+        }
+
+        // decode an interface file, nothing if it is not the one expected
+        std::unique_ptr<Interface> decode(const char* data, size_t size, uint64_t key, const std::string& path, const std::vector<const Interface*>& imports) {
+            Reader r(data, size);
+
+            const auto m = r.raw<std::array<char, 4>>();
+            if (std::memcmp(m.data(), magic, sizeof(magic)) != 0 || r.raw<uint64_t>() != key)
+                return nullptr;
+
+            const uint32_t import_count = r.u32();
+            if (import_count != imports.size())
+                return nullptr;
+            for (const Interface* dep : imports) {
+                if (r.raw<uint64_t>() != dep->key)
+                    return nullptr;
+            }
+
+            // the nodes take more room than their encoding
+            auto itf = std::unique_ptr<Interface>(new Interface{ .key = key, .path = path, .imports = imports, .decls = {}, .constants = {}, .global_writers = {}, .allocator = ArenaAllocator(4096 + 64 * size) });
+            ArenaAllocator& allocator = itf->allocator;
+
+            const auto ident = [&]() {
+                return Token{ .type = TokenType::IDENTIFIER, .line = 0, .val = r.str() };
+            };
+
+            const uint32_t decl_count = r.u32();
+            for (uint32_t i = 0; i < decl_count && r.ok; i++) {
+                switch (static_cast<Tag>(r.u8())) {
+                case Tag::STRUCT: {
+                    auto st = allocator.emplace<Node::StructDeclaration>(ident());
+                    const uint32_t count = r.u32();
+                    for (uint32_t j = 0; j < count && r.ok; j++) {
+                        const Token name = ident();
+                        st->fields.push_back(allocator.emplace<Node::Field>(name, r.type()));
+                    }
+                    itf->decls.push_back(allocator.emplace<Node::ProgStmt>(st));
+                    break;
+                }
+                case Tag::ENUM: {
+                    auto en = allocator.emplace<Node::EnumDeclaration>(ident());
+                    const uint32_t count = r.u32();
+                    for (uint32_t j = 0; j < count && r.ok; j++)
+                        en->values.push_back(ident());
+                    itf->decls.push_back(allocator.emplace<Node::ProgStmt>(en));
+                    break;
+                }
+                case Tag::CONST: {
+                    auto c = allocator.emplace<Node::StmtConst>(ident());
+                    c->type = r.type();
+
+                    Parser::ConstValue value;
+                    if (r.u8() == 0)
+                        value = r.raw<__int128>();
+                    else
+                        value = r.raw<double>();
+
+                    c->expr = literal(allocator, c->type, value);
+                    itf->constants[c->ident.val.value()] = value;
+                    itf->decls.push_back(allocator.emplace<Node::ProgStmt>(c));
+                    break;
+                }
+                case Tag::FUNC: {
+                    auto func = allocator.emplace<Node::FuncDeclaration>(ident());
+                    func->scope = nullptr;
+                    func->type = r.type();
+                    if (r.u8())
+                        itf->global_writers.insert(func->ident.val.value());
+
+                    const uint32_t count = r.u32();
+                    for (uint32_t j = 0; j < count && r.ok; j++) {
+                        const Token name = ident();
+                        const bool ref = r.u8();
+                        func->params.push_back(allocator.emplace<Node::Param>(name, r.type(), ref));
+                    }
+                    itf->decls.push_back(allocator.emplace<Node::ProgStmt>(func));
+                    break;
+                }
+                default:
+                    r.ok = false;
+                    break;
+                }
+            }
+
+            if (!r.ok || !r.at_end())
+                return nullptr;
+
+            return itf;
+        }
+
+        // map the interface file in memory and decode it, nothing if it is missing or stale
+        std::unique_ptr<Interface> load(const fs::path& file, uint64_t key, const std::string& path, const std::vector<const Interface*>& imports) {
+            trace::Span span("load interface", path);
+
+#ifdef CERN_HAS_MMAP
+            const int fd = open(file.c_str(), O_RDONLY);
+            if (fd < 0)
+                return nullptr;
+
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size == 0) {
+                close(fd);
+                return nullptr;
+            }
+
+            const size_t size = static_cast<size_t>(st.st_size);
+            void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (data == MAP_FAILED)
+                return nullptr;
+
+            auto itf = decode(static_cast<const char*>(data), size, key, path, imports);
+            munmap(data, size);
+            return itf;
+#else
+            std::ifstream in(file, std::ios::binary);
+            if (!in)
+                return nullptr;
+
+            const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            return decode(data.data(), data.size(), key, path, imports);
+#endif
+        }
+
+        // name no other compiler sharing the cache uses, to write `file` before renaming it
+        fs::path temp_path(const fs::path& file, const std::string& extension) {
+            static const std::string process = hex(std::random_device{}() ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+            static uint64_t count = 0;
+            return file.string() + "." + process + "-" + std::to_string(count++) + extension;
+        }
+
+        // another compiler may have renamed the same file first, its copy is as good as ours
+        void rename_into(const fs::path& tmp, const fs::path& file) {
+            std::error_code ec;
+            fs::rename(tmp, file, ec);
+            if (!ec)
+                return;
+
+            if (fs::exists(file)) {
+                fs::remove(tmp, ec);
+                return;
+            }
+
+            exit_with("could not write " + file.string() + " (" + ec.message() + ")");
+        }
+
+        // written next to its final name then renamed, another build never reads half a file
+        void write_file(const fs::path& file, const std::string& contents) {
+            const fs::path tmp = temp_path(file, ".tmp");
+
+            {
+                std::ofstream out(tmp, std::ios::binary);
+                out << contents;
+                if (!out)
+                    exit_with("could not write " + tmp.string());
+            }
+
+            rename_into(tmp, file);
+        }
+
+        const Interface* build(const std::string& path, const std::string& compile);
+
+        std::unordered_map<std::string, const Interface*> import_all(const std::string& path, const std::vector<Token>& tokens, const std::string& compile, std::vector<const Interface*>& in_order) {
+            std::unordered_map<std::string, const Interface*> imports;
+
+            for (size_t i = 0; i + 1 < tokens.size(); i++) {
+                if (tokens[i].type != TokenType::IMPORT || tokens[i + 1].type != TokenType::STRING_LITERAL)
+                    continue;
+
+                const std::string& name = tokens[i + 1].val.value();
+                if (imports.count(name))
+                    continue;
+
+                // relative to the directory of the file importing it
+                const fs::path file = fs::path(path).parent_path() / name;
+                if (!fs::is_regular_file(file))
+                    exit_with("cannot open module '" + name + "' imported on line " + std::to_string(tokens[i].line) + " of " + path);
+
+                const Interface* m = build(file.string(), compile);
+                imports[name] = m;
+                in_order.push_back(m);
+            }
+
+            return imports;
+        }
+
+        const Interface* build(const std::string& path, const std::string& compile) {
+            const std::string canonical = fs::weakly_canonical(path).string();
+
+            if (const auto it = built.find(canonical); it != built.end())
+                return it->second;
+
+            if (building.count(canonical))
+                exit_with("import cycle through the module " + path);
+            building.insert(canonical);
+
+            trace::Span span("module", path);
+
+            std::string source;
+            {
+                std::ifstream in(path);
+                std::stringstream ss;
+                ss << in.rdbuf();
+                source = ss.str();
+            }
+
+            // only the imports are looked at before the cache is, the tokens are parsed on a miss
+            std::vector<Token> tokens = Tokenizer(std::string(source)).tokenize();
+
+            std::vector<const Interface*> deps;
+            auto imports = import_all(path, tokens, compile, deps);
+
+            uint64_t key = hash(source, hash(std::string_view(magic, sizeof(magic)), compiler_key()));
+            for (const Interface* dep : deps)
+                key = hash(std::string_view(reinterpret_cast<const char*>(&dep->key), sizeof(dep->key)), key);
+
+            // two copies of the same module are one module
+            if (const auto it = loaded.find(key); it != loaded.end()) {
+                built[canonical] = it->second.get();
+                building.erase(canonical);
+                return it->second.get();
+            }
+
+            std::error_code ec;
+            fs::create_directories(cache_dir, ec);
+            if (ec)
+                exit_with("could not create " + cache_dir.string() + " (" + ec.message() + ")");
+
+            const fs::path interface_file = cache_dir / (hex(key) + ".cei");
+            const fs::path cpp_file = cache_dir / (hex(key) + ".cpp");
+            // the same module compiled with other flags (debug, release) is another object
+            const fs::path object_file = cache_dir / (hex(key) + "-" + hex(hash(compile)) + ".o");
+
+            std::unique_ptr<Interface> itf;
+            if (fs::exists(cpp_file))
+                itf = load(interface_file, key, path, deps);
+
+            if (!itf) {
+                trace::Span compile_span("compile module", path);
+
+                Parser parser(std::move(tokens), std::move(imports));
+                const std::optional<Node::Prog> prog = parser.parse_prog();
+                if (!prog.has_value())
+                    exit_with("invalid module " + path);
+
+                // the program importing the module has the only main
+                for (const Node::ProgStmt* s : prog.value().stmts) {
+                    if (const auto func = std::get_if<Node::FuncDeclaration*>(&s->var); func && (*func)->ident.val.value() == "main")
+                        exit_with("the module " + path + " cannot declare `main`, only the program importing it can");
+                }
+
+                write_file(cpp_file, gen::prog(prog.value(), true));
+                write_file(interface_file, interface_bytes(key, deps, prog.value(), parser));
+
+                itf = load(interface_file, key, path, deps);
+                if (!itf)
+                    exit_with("could not read back the interface of " + path);
+            }
+
+            if (!fs::exists(object_file)) {
+                trace::Span backend_span("backend module", path);
+
+                const fs::path tmp = temp_path(object_file, ".tmp.o");
+                const std::string command = compile + " " + cpp_file.string() + " -o " + tmp.string();
+                if (system(command.c_str()) != 0)
+                    exit_with("could not compile the module " + path);
+
+                rename_into(tmp, object_file);
+            }
+
+            object_files.push_back(object_file.string());
+
+            const Interface* m = itf.get();
+            loaded[key] = std::move(itf);
+            built[canonical] = m;
+            building.erase(canonical);
+
+            return m;
+        }
+    }
+
+    std::unordered_map<std::string, const Interface*> build_imports(const std::string& path, const std::vector<Token>& tokens, const std::string& compile) {
+        std::vector<const Interface*> in_order;
+        return import_all(path, tokens, compile, in_order);
+    }
+
+    const std::vector<std::string>& objects() {
+        return object_files;
+    }
+}
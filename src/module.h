@@ -0,0 +1,40 @@
+#pragma once
+
+#include "parser.h"
+
+#include <cstdint>
+
+// separate compilation of the modules named by `import "file.ce"`
+//
+// a module is compiled on its own into an object file, linked with the program at the end, and the
+// declarations it exports (structs, enums, constants and function signatures) are written to a binary
+// interface file. both live in .cern-cache/, named after a hash of the source of the module and of the
+// interfaces it imports: a module is only compiled again when it or one of its imports changed, and
+// importing it otherwise costs an mmap of its interface instead of a parse
+namespace module {
+    // declarations exported by a module, read back from its interface file
+    struct Interface {
+        // hash of the source of the module and of the keys of its imports
+        uint64_t key;
+        // path of the source, for the errors
+        std::string path;
+        // interfaces of the modules it imports, in order
+        std::vector<const Interface*> imports;
+        // structs, enums, constants and functions (without a scope) in the order of the source
+        std::vector<Node::ProgStmt*> decls;
+        // value of each constant
+        std::unordered_map<std::string, Parser::ConstValue> constants;
+        // functions writing to the globals of the module
+        std::unordered_set<std::string> global_writers;
+        // holds the nodes of decls
+        ArenaAllocator allocator;
+    };
+
+    // build the modules imported by `tokens`, the source of the file `path`, and the modules they import
+    // (or find them in the cache); the map goes from the path written in each `import` to its interface
+    // compile: backend command compiling c++ without linking, the source and the object are appended
+    std::unordered_map<std::string, const Interface*> build_imports(const std::string& path, const std::vector<Token>& tokens, const std::string& compile);
+
+    // object files of the modules built so far, to link with the program
+    const std::vector<std::string>& objects();
+}
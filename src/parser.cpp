@@ -1,25 +1,519 @@
 #include "parser.h"
 
 #include "buildin.h"
+#include "module.h"
+#include "trace.h"
 
 #include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <utility>
 
 const std::unordered_map<std::string, VarType> Parser::buildin_func_type = { {"print", VarType::VOID}, {"println", VarType::VOID},
  {"itoc", VarType::CHAR}, {"ctoi", VarType::INT},
+ {"push", VarType::VOID}, {"pop", VarType::VOID}, {"len", VarType::INT}, {"reserve", VarType::VOID},
+ {"get", VarType::VOID}, {"set", VarType::VOID}, {"has", VarType::BOOL}, {"remove", VarType::BOOL},
+ {"frame_bytes", VarType::I64}, {"frame_peak", VarType::I64}, {"now_ns", VarType::I64}, {"cycles", VarType::U64},
+ {"read_int", VarType::INT}, {"read_char", VarType::CHAR}, {"read_line", VarType::STRING}, {"read_all", VarType::STRING}, {"eof", VarType::BOOL},
+ {"map_file", VarType::BYTES}, {"file_size", VarType::I64}, {"write_file", VarType::BOOL},
 };
 
 bool Parser::is_buildin_func(const std::string& func) {
     return buildin_func_type.count(func);
 }
 
-std::unordered_map<std::string, VarType> Parser::identifiers{};
+VarType Parser::buildin_call_type(const Node::FuncCall* fcall) {
+    const std::string& func = fcall->ident.val.value();
 
-bool Parser::is_var(const std::string& var) {
+    // push, pop and reserve modify the list they are given, set and remove the map
+    if ((func == "push" || func == "pop" || func == "reserve" || func == "set" || func == "remove") && !fcall->args.empty())
+        check_mutable(fcall->args[0]);
+
+    // the key and the value can be literals of the types of the map (set(counts, 1, 0) on a map<u8, i64>)
+    if ((func == "get" || func == "set" || func == "has" || func == "remove") && fcall->args.size() >= 2 &&
+        fcall->args[0]->type.kind == VarType::MAP) {
+        coerce_literal(fcall->args[1], *fcall->args[0]->type.key);
+        if (func == "set" && fcall->args.size() == 3)
+            coerce_literal(fcall->args[2], *fcall->args[0]->type.elem);
+    }
+
+    // get returns a value of the map it is given
+    if (func == "get") {
+        if (fcall->args.size() != 2 || fcall->args[0]->type.kind != VarType::MAP)
+            exit_with("a map and a key", "function `get` takes");
+        return *fcall->args[0]->type.elem;
+    }
+
+    // the pushed value can be a literal of the element type (push(bytes, 255) on a list<u8>)
+    if (func == "push" && fcall->args.size() == 2 && fcall->args[0]->type.kind == VarType::LIST)
+        coerce_literal(fcall->args[1], *fcall->args[0]->type.elem);
+
+    // pop returns an element of the list it is given
+    if (func == "pop") {
+        if (fcall->args.size() != 1 || fcall->args[0]->type.kind != VarType::LIST)
+            exit_with("a list", "function `pop` takes");
+        return *fcall->args[0]->type.elem;
+    }
+
+    // a mapped file can be larger than an int
+    if (func == "len" && fcall->args.size() == 1 && fcall->args[0]->type.kind == VarType::BYTES)
+        return VarType::I64;
+
+    return buildin_func_type.at(func);
+}
+
+bool Parser::is_var(const std::string& var) const {
     return identifiers.count(var);
 }
 
+size_t Parser::enum_index(const VarType& t, const Token& value) {
+    const std::vector<Token>& values = enums.at(t.name)->values;
+
+    for (size_t i = 0; i < values.size(); i++) {
+        if (values[i].val.value() == value.val.value())
+            return i;
+    }
+
+    exit_with(t.name + " value `" + value.val.value() + "`", "unknown");
+    return 0; // unreachable
+}
+
+const Node::Field* Parser::field(const VarType& t, const std::string& name) {
+    for (const Node::Field* f : structs.at(t.name)->fields) {
+        if (f->ident.val.value() == name)
+            return f;
+    }
+
+    exit_with(t.name + " field `" + name + "`", "unknown");
+    return nullptr; // unreachable
+}
+
+void Parser::begin_scope() {
+    scopes.emplace_back();
+}
+
+void Parser::end_scope() {
+    for (const std::string& ident : scopes.back()) {
+        identifiers.erase(ident);
+        immutables.erase(ident);
+        constants.erase(ident);
+        view_roots.erase(ident);
+    }
+
+    scopes.pop_back();
+}
+
+void Parser::declare(const Token& ident, const VarType& type) {
+    if (is_var(ident.val.value()) || structs.count(ident.val.value()) || enums.count(ident.val.value()))
+        exit_with("'" + ident.val.value() + "' already used", "identifier");
+
+    identifiers[ident.val.value()] = type;
+
+    if (!scopes.empty())
+        scopes.back().push_back(ident.val.value());
+}
+
+bool Parser::declared_since(const std::string& ident, size_t depth) const {
+    for (size_t i = depth; i < scopes.size(); i++) {
+        if (std::find(scopes[i].begin(), scopes[i].end(), ident) != scopes[i].end())
+            return true;
+    }
+    return false;
+}
+
+size_t Parser::scope_depth(const std::string& ident) const {
+    for (size_t i = scopes.size(); i > 0; i--) {
+        if (std::find(scopes[i - 1].begin(), scopes[i - 1].end(), ident) != scopes[i - 1].end())
+            return i;
+    }
+    return 0;
+}
+
+bool Parser::converts(const VarType& from, const VarType& to) {
+    return from == to || (from.kind == VarType::STRING && to.kind == VarType::STR_VIEW);
+}
+
+std::vector<std::string> Parser::viewed_strings(const Node::Expr* e) {
+    if (const auto t = std::get_if<Node::Term*>(&e->var))
+        return viewed_strings(*t);
+
+    // an operator builds a new string
+    return { "" };
+}
+
+std::vector<std::string> Parser::viewed_strings(const Node::Term* t) {
+    if (const auto ident = std::get_if<Node::TermIdentifier*>(&t->var)) {
+        const std::string& name = (*ident)->ident.val.value();
+        if (t->type.kind != VarType::STR_VIEW)
+            return { name };
+        // a parameter is not in view_roots, its string outlives the call
+        const auto it = view_roots.find(name);
+        return it != view_roots.end() ? it->second : std::vector<std::string>{};
+    }
+
+    if (const auto paren = std::get_if<Node::TermParen*>(&t->var))
+        return viewed_strings((*paren)->expr);
+
+    if (const auto slice = std::get_if<Node::TermSlice*>(&t->var))
+        return viewed_strings((*slice)->base);
+
+    // a string stored in a struct or a container lives as long as its variable
+    if (std::holds_alternative<Node::TermField*>(t->var) || std::holds_alternative<Node::TermIndex*>(t->var)) {
+        const Node::Term* base = t;
+        while (true) {
+            if (const auto field = std::get_if<Node::TermField*>(&base->var))
+                base = (*field)->base;
+            else if (const auto index = std::get_if<Node::TermIndex*>(&base->var))
+                base = (*index)->base;
+            else
+                break;
+        }
+        if (const auto ident = std::get_if<Node::TermIdentifier*>(&base->var))
+            return { (*ident)->ident.val.value() };
+        return { "" };
+    }
+
+    // the view returned by a function points into the strings it was given
+    if (const auto fcall = std::get_if<Node::FuncCall*>(&t->var); fcall != nullptr && t->type.kind == VarType::STR_VIEW) {
+        std::vector<std::string> roots;
+        for (const Node::Expr* arg : (*fcall)->args) {
+            if (arg->type.kind != VarType::STRING && arg->type.kind != VarType::STR_VIEW)
+                continue;
+            // a literal given for a string parameter is copied into a temporary
+            if (const auto lit = std::get_if<Node::Term*>(&arg->var); lit != nullptr && std::holds_alternative<Node::TermStringLiteral*>((*lit)->var)) {
+                roots.push_back("");
+                continue;
+            }
+            const std::vector<std::string> arg_roots = viewed_strings(arg);
+            roots.insert(roots.end(), arg_roots.begin(), arg_roots.end());
+        }
+        return roots;
+    }
+
+    // a literal is a constant of the program, it outlives every view
+    if (std::holds_alternative<Node::TermStringLiteral*>(t->var))
+        return {};
+
+    // strings returned by functions are temporaries
+    return { "" };
+}
+
+std::vector<std::string> Parser::check_view_lifetime(const Node::Expr* e, size_t depth, const std::string& target) {
+    const std::vector<std::string> roots = viewed_strings(e);
+
+    for (const std::string& root : roots) {
+        if (root.empty())
+            exit_with("view of a temporary string, store the string in a variable first", "cannot keep a");
+
+        if (scope_depth(root) <= depth)
+            continue;
+
+        if (target.empty())
+            exit_with("view of the local string '" + root + "', it would outlive the function", "cannot return a");
+        exit_with("'" + target + "' would outlive the string '" + root + "' it points into", "view");
+    }
+
+    return roots;
+}
+
+void Parser::check_not_viewed(const std::string& ident) {
+    for (const auto& [view, roots] : view_roots) {
+        if (std::find(roots.begin(), roots.end(), ident) != roots.end())
+            exit_with("'" + ident + "' while the view '" + view + "' points into it", "cannot modify");
+    }
+}
+
+void Parser::check_no_global_view(const Node::FuncCall* fcall) {
+    const std::string& func = fcall->ident.val.value();
+
+    for (const auto& [view, roots] : view_roots) {
+        for (const std::string& root : roots) {
+            if (!declared_since(root, 0))
+                exit_with("`" + func + "` while the view '" + view + "' points into the global '" + root + "', it could modify it", "cannot call");
+        }
+    }
+
+    // the parameters of the function would see the global change under them
+    for (const Node::Expr* arg : fcall->args) {
+        if (arg->type.kind != VarType::STRING && arg->type.kind != VarType::STR_VIEW)
+            continue;
+        for (const std::string& root : viewed_strings(arg)) {
+            if (!root.empty() && !declared_since(root, 0))
+                exit_with("`" + func + "` with the global '" + root + "' or a view into it, it could modify it", "cannot call");
+        }
+    }
+}
+
+void Parser::check_parallel_self_call() {
+    const std::optional<int> line = std::exchange(parallel_self_call, std::nullopt);
+    if (line.has_value() && global_writers.count(current_func.value()))
+        exit_with("`" + current_func.value() + "` on line " + std::to_string(line.value()) + ", it writes to global variables", "parallel for cannot call");
+}
+
+void Parser::check_storable(const VarType& t, const std::string& where) {
+    if (t.kind == VarType::STR_VIEW)
+        exit_with(where + ", it could outlive the string it points into", "a str_view cannot be stored in");
+}
+
+bool Parser::is_parallel_index(const Node::Expr* e) const {
+    if (e == nullptr || !parallel.has_value())
+        return false;
+
+    const auto term = std::get_if<Node::Term*>(&e->var);
+    if (term == nullptr)
+        return false;
+
+    const auto ident = std::get_if<Node::TermIdentifier*>(&(*term)->var);
+    return ident != nullptr && (*ident)->ident.val.value() == parallel->var;
+}
+
+void Parser::check_mutable(const Token& ident, const Node::Expr* index) {
+    const std::string& name = ident.val.value();
+
+    if (immutables.count(name))
+        exit_with(immutables.at(name), "cannot modify");
+
+    // a string modified could move its characters, or free them
+    check_not_viewed(name);
+
+    // globals are not declared in any scope
+    if (current_func.has_value() && !declared_since(name, 0))
+        global_writers.insert(current_func.value());
+
+    // iterations run at the same time, each one can only write to its own elements
+    if (parallel.has_value() && !declared_since(name, parallel->depth)) {
+        if (!is_parallel_index(index))
+            exit_with("to '" + name + "', only to its locals and to elements indexed by `" + parallel->var + "`", "parallel for cannot write");
+        parallel->written.insert(name);
+    }
+}
+
+void Parser::check_mutable(const Node::Term* t) {
+    // walk down to the variable, keeping the index applied directly to it (i in xs[i].pos)
+    const Node::Expr* index = nullptr;
+
+    while (true) {
+        if (const auto ident = std::get_if<Node::TermIdentifier*>(&t->var)) {
+            check_mutable((*ident)->ident, index);
+            return;
+        }
+        else if (const auto term_index = std::get_if<Node::TermIndex*>(&t->var)) {
+            if ((*term_index)->base->type.kind == VarType::BYTES)
+                exit_with("the elements of bytes, the mapped file is read-only", "cannot write to");
+            if ((*term_index)->base->type.kind == VarType::STRING || (*term_index)->base->type.kind == VarType::STR_VIEW)
+                exit_with("the characters of a string, build a new one", "cannot write to");
+            index = (*term_index)->index;
+            t = (*term_index)->base;
+        }
+        else if (const auto field = std::get_if<Node::TermField*>(&t->var)) {
+            t = (*field)->base;
+        }
+        else {
+            exit_with("variable or element", "expected");
+            return; // unreachable
+        }
+    }
+}
+
+void Parser::check_mutable(const Node::Expr* e) {
+    if (const auto t = std::get_if<Node::Term*>(&e->var))
+        check_mutable(*t);
+    else
+        exit_with("variable or element", "expected");
+}
+
+void Parser::check_args(const Node::FuncCall* fcall) {
+    const Node::FuncDeclaration* func = functions.at(fcall->ident.val.value());
+
+    if (fcall->args.size() != func->params.size())
+        exit_with(std::to_string(func->params.size()) + " argument(s)", "function `" + func->ident.val.value() + "` takes");
+
+    for (size_t i = 0; i < func->params.size(); i++) {
+        const Node::Param* param = func->params[i];
+
+        coerce_literal(fcall->args[i], param->type);
+
+        if (!converts(fcall->args[i]->type, param->type))
+            exit_with(to_string(param->type), "argument `" + param->ident.val.value() + "` must be of type");
+
+        // the argument is bound to a non-const reference
+        if (param->ref)
+            check_mutable(fcall->args[i]);
+    }
+
+    // a variable given whole to a ref parameter and to another one would be two parameters of the body,
+    // written through one while read through the other (distinct elements, as in swap(a[i], a[j]), are fine)
+    for (size_t i = 0; i < func->params.size(); i++) {
+        if (!func->params[i]->ref)
+            continue;
+
+        const auto [root, whole] = argument_root(fcall->args[i]);
+        if (root.empty())
+            continue;
+
+        for (size_t j = 0; j < func->params.size(); j++) {
+            if (j == i)
+                continue;
+
+            const auto [other, other_whole] = argument_root(fcall->args[j]);
+            if (other == root && (whole || other_whole))
+                exit_with("'" + root + "' both to the ref parameter `" + func->params[i]->ident.val.value() + "` and to `" + func->params[j]->ident.val.value() + "`", "cannot pass");
+        }
+    }
+}
+
+std::pair<std::string, bool> Parser::argument_root(const Node::Expr* e) {
+    const auto term = std::get_if<Node::Term*>(&e->var);
+    if (term == nullptr)
+        return { "", false };
+
+    const Node::Term* t = *term;
+    bool whole = true;
+    while (true) {
+        if (const auto paren = std::get_if<Node::TermParen*>(&t->var)) {
+            const auto inner = std::get_if<Node::Term*>(&(*paren)->expr->var);
+            if (inner == nullptr)
+                return { "", false };
+            t = *inner;
+        }
+        else if (const auto field = std::get_if<Node::TermField*>(&t->var)) {
+            t = (*field)->base;
+            whole = false;
+        }
+        else if (const auto index = std::get_if<Node::TermIndex*>(&t->var)) {
+            t = (*index)->base;
+            whole = false;
+        }
+        else
+            break;
+    }
+
+    if (const auto ident = std::get_if<Node::TermIdentifier*>(&t->var))
+        return { (*ident)->ident.val.value(), whole };
+    return { "", false };
+}
+
 std::optional<VarType> Parser::get_return_type(VarType t1, TokenType op, VarType t2) {
+    // arrays and lists can only be compared as a whole
+    if (t1.is_container() || t2.is_container()) {
+        // vectors and structs have no equality, neither do the containers holding them
+        const VarType* inner = &t1;
+        while (inner->is_container())
+            inner = inner->elem.get();
+
+        if ((op == TokenType::IS_EQUAL || op == TokenType::IS_NOT_EQUAL) && t1 == t2 &&
+            !inner->is_vector() && inner->kind != VarType::STRUCT)
+            return VarType::BOOL;
+        return {};
+    }
+
+    if (t1.kind == VarType::STRUCT || t2.kind == VarType::STRUCT || t1.kind == VarType::MAP || t2.kind == VarType::MAP)
+        return {};
+
+    // values of an enum are only compared with values of the same enum, bytes with bytes (by content)
+    if (t1.kind == VarType::ENUM || t2.kind == VarType::ENUM || t1.kind == VarType::BYTES || t2.kind == VarType::BYTES) {
+        if ((op == TokenType::IS_EQUAL || op == TokenType::IS_NOT_EQUAL) && t1 == t2)
+            return VarType::BOOL;
+        return {};
+    }
+
+    // a view is only compared, with a view or a string, character by character
+    if (t1.kind == VarType::STR_VIEW || t2.kind == VarType::STR_VIEW) {
+        const bool text = (t1.kind == VarType::STR_VIEW || t1.kind == VarType::STRING) &&
+                          (t2.kind == VarType::STR_VIEW || t2.kind == VarType::STRING);
+        switch (op) {
+        case TokenType::GREATER_OR_EQUAL:
+        case TokenType::GREATER:
+        case TokenType::LOWER_OR_EQUAL:
+        case TokenType::LOWER:
+        case TokenType::IS_EQUAL:
+        case TokenType::IS_NOT_EQUAL:
+            if (text)
+                return VarType::BOOL;
+            return {};
+
+        default:
+            return {};
+        }
+    }
+
+    // vectors are combined element-wise with a vector of the same size or with a number
+    if (t1.is_vector() || t2.is_vector()) {
+        switch (op) {
+        case TokenType::PLUS:
+        case TokenType::MINUS:
+        case TokenType::STAR:
+        case TokenType::SLASH:
+            if (t1 == t2 || (t1.is_vector() && t2.is_numeric()))
+                return t1;
+            if (t1.is_numeric() && t2.is_vector())
+                return t2;
+            return {};
+
+        default:
+            return {};
+        }
+    }
+
+    // floating point arithmetic takes the widest type of its operands (int < float < double)
+    if (t1 == VarType::FLOAT || t1 == VarType::DOUBLE || t2 == VarType::FLOAT || t2 == VarType::DOUBLE) {
+        if (!t1.is_numeric() || !t2.is_numeric())
+            return {};
+
+        switch (op) {
+        case TokenType::PLUS:
+        case TokenType::MINUS:
+        case TokenType::STAR:
+        case TokenType::SLASH:
+            if (t1 == VarType::DOUBLE || t2 == VarType::DOUBLE)
+                return VarType::DOUBLE;
+            return VarType::FLOAT;
+
+        case TokenType::GREATER_OR_EQUAL:
+        case TokenType::GREATER:
+        case TokenType::LOWER_OR_EQUAL:
+        case TokenType::LOWER:
+        case TokenType::IS_EQUAL:
+        case TokenType::IS_NOT_EQUAL:
+            return VarType::BOOL;
+
+        default:
+            return {};
+        }
+    }
+
+    if (t1.is_integer() && t2.is_integer()) {
+        switch (op) {
+        case TokenType::PLUS:
+        case TokenType::MINUS:
+        case TokenType::STAR:
+        case TokenType::SLASH:
+        case TokenType::PERCENT:
+        case TokenType::BIT_AND:
+        case TokenType::BIT_OR:
+        case TokenType::BIT_XOR:
+            return promote(t1, t2);
+
+        // a shift keeps the type of the shifted value
+        case TokenType::SHIFT_LEFT:
+        case TokenType::SHIFT_RIGHT:
+            return t1;
+
+        default:
+            break;
+        }
+    }
+
     switch (op) {
+    // both sides are always evaluated, unlike && and ||
+    case TokenType::BIT_AND:
+    case TokenType::BIT_OR:
+    case TokenType::BIT_XOR:
+        if (t1 == VarType::BOOL && t2 == VarType::BOOL)
+            return VarType::BOOL;
+        return {};
+
     case TokenType::AND:
     case TokenType::OR:
         if (t1 == VarType::BOOL && t2 == VarType::BOOL)
@@ -27,6 +521,11 @@ std::optional<VarType> Parser::get_return_type(VarType t1, TokenType op, VarType
         return {};
 
     case TokenType::PLUS:
+        if ((t1 == VarType::STRING && (t2 == VarType::STRING || t2 == VarType::CHAR)) ||
+            (t1 == VarType::CHAR && t2 == VarType::STRING))
+            return VarType::STRING;
+        return VarType::INT;
+
     case TokenType::MINUS:
     case TokenType::INCREMENTATOR:
     case TokenType::DECREMENTATOR:
@@ -51,538 +550,1696 @@ std::optional<VarType> Parser::get_return_type(VarType t1, TokenType op, VarType
     }
 }
 
-std::string to_string(VarType t) {
-    switch (t) {
-    case VarType::VOID:
-        return "void";
-    case VarType::BOOL:
-        return "bool";
-    case VarType::INT:
-        return "int";
-    case VarType::CHAR:
-        return "char";
-    case VarType::STRING:
-        return "string";
-    default:
-        return "auto";
+VarType Parser::promote(const VarType& t1, const VarType& t2) {
+    // the widest operand wins, and the unsigned one between operands of the same width (as in c++)
+    if (t1.bits() != t2.bits())
+        return t1.bits() > t2.bits() ? t1 : t2;
+    return t1.is_unsigned() ? t1 : t2;
+}
+
+void Parser::coerce_literal(Node::Expr* e, const VarType& t, bool check_range) {
+    if (!t.is_integer())
+        return;
+
+    const auto term = std::get_if<Node::Term*>(&e->var);
+    if (term == nullptr)
+        return;
+
+    // an integer constant converts like the literal of its value (var x : u8 = N)
+    if (const auto ident = std::get_if<Node::TermIdentifier*>(&(*term)->var)) {
+        const auto value = int_constant((*ident)->ident);
+        if (!value.has_value() || !(*term)->type.is_integer() || value.value() < t.min() || value.value() > t.max())
+            return;
+
+        e->type = t;
+        (*term)->type = t;
+        (*ident)->type = t;
+        return;
+    }
+
+    const auto lit = std::get_if<Node::TermIntegerLiteral*>(&(*term)->var);
+    if (lit == nullptr)
+        return;
+
+    const std::string& value = (*lit)->int_lit.val.value();
+    if (std::stoull(value) > t.max()) {
+        if (check_range)
+            exit_with(value + " out of range for " + to_string(t), "integer literal");
+        return;
     }
+
+    e->type = t;
+    (*term)->type = t;
 }
 
-VarType to_variable_type(TokenType t) {
-    switch (t) {
-    case TokenType::TYPE_BOOL:
-    case TokenType::BOOLEAN_LITEARL:
-        return VarType::BOOL;
-    case TokenType::TYPE_INT:
-    case TokenType::INTEGER_LITERAL:
-        return VarType::INT;
-    case TokenType::TYPE_CHAR:
-    case TokenType::CHAR_LITERAL:
-        return VarType::CHAR;
-    case TokenType::TYPE_STRING:
-    case TokenType::STRING_LITERAL:
-        return VarType::STRING;
-    default:
-        return VarType::VOID;
+// `v` converted to the integer type `t`, wrapping around as a conversion does in c++
+static __int128 wrap(__int128 v, const VarType& t) {
+    const __int128 modulo = static_cast<__int128>(1) << t.bits();
+
+    v %= modulo;
+    if (v < 0)
+        v += modulo;
+    if (!t.is_unsigned() && v > static_cast<__int128>(t.max()))
+        v -= modulo;
+
+    return v;
+}
+
+static double as_double(const Parser::ConstValue& v) {
+    if (const auto i = std::get_if<__int128>(&v))
+        return static_cast<double>(*i);
+    return std::get<double>(v);
+}
+
+std::optional<__int128> Parser::int_constant(const Token& ident) const {
+    const auto it = constants.find(ident.val.value());
+    if (it == constants.end())
+        return {};
+
+    if (const auto i = std::get_if<__int128>(&it->second))
+        return *i;
+    return {};
+}
+
+std::optional<Parser::ConstValue> Parser::fold(const Node::Term* t) {
+    if (const auto lit = std::get_if<Node::TermIntegerLiteral*>(&t->var))
+        return static_cast<__int128>(std::stoull((*lit)->int_lit.val.value()));
+
+    if (const auto lit = std::get_if<Node::TermBooleanLiteral*>(&t->var))
+        return static_cast<__int128>((*lit)->bool_lit.val.value() == "true");
+
+    if (const auto lit = std::get_if<Node::TermCharLiteral*>(&t->var))
+        return static_cast<__int128>(static_cast<signed char>((*lit)->char_lit.val.value()[0]));
+
+    // 1.5f is rounded to a float
+    if (const auto lit = std::get_if<Node::TermFloatLiteral*>(&t->var)) {
+        const double v = std::stod((*lit)->float_lit.val.value());
+        return t->type.kind == VarType::FLOAT ? static_cast<double>(static_cast<float>(v)) : v;
+    }
+
+    if (const auto value = std::get_if<Node::TermEnumValue*>(&t->var))
+        return static_cast<__int128>((*value)->index);
+
+    if (const auto ident = std::get_if<Node::TermIdentifier*>(&t->var)) {
+        const auto it = constants.find((*ident)->ident.val.value());
+        if (it == constants.end())
+            return {};
+        return it->second;
+    }
+
+    if (const auto paren = std::get_if<Node::TermParen*>(&t->var))
+        return fold((*paren)->expr);
+
+    // numeric conversions: int(x), float(n), ...
+    if (const auto construct = std::get_if<Node::TermConstruct*>(&t->var)) {
+        const VarType& to = (*construct)->type;
+        if (!to.is_numeric() || (*construct)->args.size() != 1)
+            return {};
+
+        const auto v = fold((*construct)->args[0]);
+        if (!v.has_value())
+            return {};
+
+        if (to.kind == VarType::FLOAT)
+            return static_cast<double>(static_cast<float>(as_double(v.value())));
+        if (to.kind == VarType::DOUBLE)
+            return as_double(v.value());
+
+        if (const auto i = std::get_if<__int128>(&v.value()))
+            return wrap(*i, to);
+
+        // a float is truncated, and must fit in the integer type
+        const double d = std::trunc(std::get<double>(v.value()));
+        if (!(d >= static_cast<double>(to.min()) && d <= static_cast<double>(to.max())))
+            exit_with(std::to_string(d) + " out of range for " + to_string(to), "constant conversion of");
+        return static_cast<__int128>(d);
     }
+
+    // variables, calls, elements and fields are only known at run time
+    return {};
 }
 
-Parser::Parser(std::vector<Token> tokens)
-    : tokens(std::move(tokens)), allocator(1024 * 1024 * 4) {
-} // 4mb
+std::optional<Parser::ConstValue> Parser::fold(const Node::Expr* e) {
+    if (const auto t = std::get_if<Node::Term*>(&e->var))
+        return fold(*t);
+
+    if (const auto n = std::get_if<Node::ExprNot*>(&e->var)) {
+        const auto v = fold((*n)->expr);
+        if (!v.has_value())
+            return {};
+        return static_cast<__int128>(std::get<__int128>(v.value()) == 0);
+    }
+
+    if (const auto n = std::get_if<Node::ExprBitNot*>(&e->var)) {
+        const auto v = fold((*n)->expr);
+        if (!v.has_value())
+            return {};
+        return wrap(~std::get<__int128>(v.value()), e->type);
+    }
+
+    // ++ and -- modify a variable
+    const auto bin = std::get_if<Node::BinExpr*>(&e->var);
+    if (bin == nullptr)
+        return {};
+
+    const auto [l, r] = std::visit([](const auto* b) { return std::pair<const Node::Expr*, const Node::Expr*>(b->lside, b->rside); }, (*bin)->var);
+
+    const auto lv = fold(l);
+    const auto rv = fold(r);
+    if (!lv.has_value() || !rv.has_value())
+        return {};
+
+    const TokenType op = (*bin)->op;
+
+    if (std::holds_alternative<double>(lv.value()) || std::holds_alternative<double>(rv.value())) {
+        const double a = as_double(lv.value());
+        const double b = as_double(rv.value());
+
+        double v = 0;
+        switch (op) {
+        case TokenType::PLUS:
+            v = a + b;
+            break;
+        case TokenType::MINUS:
+            v = a - b;
+            break;
+        case TokenType::STAR:
+            v = a * b;
+            break;
+        case TokenType::SLASH:
+            if (b == 0)
+                exit_with("in constant expression", "division by zero");
+            v = a / b;
+            break;
+        case TokenType::IS_EQUAL:
+            return static_cast<__int128>(a == b);
+        case TokenType::IS_NOT_EQUAL:
+            return static_cast<__int128>(a != b);
+        case TokenType::GREATER_OR_EQUAL:
+            return static_cast<__int128>(a >= b);
+        case TokenType::GREATER:
+            return static_cast<__int128>(a > b);
+        case TokenType::LOWER_OR_EQUAL:
+            return static_cast<__int128>(a <= b);
+        case TokenType::LOWER:
+            return static_cast<__int128>(a < b);
+        default:
+            return {};
+        }
+
+        return e->type.kind == VarType::FLOAT ? static_cast<double>(static_cast<float>(v)) : v;
+    }
+
+    __int128 a = std::get<__int128>(lv.value());
+    __int128 b = std::get<__int128>(rv.value());
+
+    switch (op) {
+    case TokenType::AND:
+        return static_cast<__int128>(a != 0 && b != 0);
+    case TokenType::OR:
+        return static_cast<__int128>(a != 0 || b != 0);
+    case TokenType::IS_EQUAL:
+    case TokenType::IS_NOT_EQUAL:
+    case TokenType::GREATER_OR_EQUAL:
+    case TokenType::GREATER:
+    case TokenType::LOWER_OR_EQUAL:
+    case TokenType::LOWER: {
+        // c++ compares an int and an u32 as two u32
+        if (l->type.is_integer() && r->type.is_integer()) {
+            const VarType common = promote(l->type, r->type);
+            if (common.bits() >= 32) {
+                a = wrap(a, common);
+                b = wrap(b, common);
+            }
+        }
+
+        switch (op) {
+        case TokenType::IS_EQUAL:
+            return static_cast<__int128>(a == b);
+        case TokenType::IS_NOT_EQUAL:
+            return static_cast<__int128>(a != b);
+        case TokenType::GREATER_OR_EQUAL:
+            return static_cast<__int128>(a >= b);
+        case TokenType::GREATER:
+            return static_cast<__int128>(a > b);
+        case TokenType::LOWER_OR_EQUAL:
+            return static_cast<__int128>(a <= b);
+        default:
+            return static_cast<__int128>(a < b);
+        }
+    }
+    case TokenType::SHIFT_LEFT:
+    case TokenType::SHIFT_RIGHT: {
+        // the shifted value is at least an int in c++, the count must be below its width
+        if (b < 0 || b >= std::max(l->type.bits(), 32))
+            exit_with("in constant expression", "shift count out of range");
+
+        if (op == TokenType::SHIFT_LEFT)
+            return wrap(static_cast<__int128>(static_cast<unsigned __int128>(a) << static_cast<int>(b)), e->type);
+        return a >> static_cast<int>(b);
+    }
+    default:
+        break;
+    }
+
+    const VarType& t = e->type;
+
+    // operands of an int or wider are converted to the type of the result (-1 / 2u), narrower ones are computed as ints
+    if (t.is_integer() && t.bits() >= 32) {
+        a = wrap(a, t);
+        b = wrap(b, t);
+    }
+
+    __int128 v = 0;
+    switch (op) {
+    case TokenType::PLUS:
+        v = a + b;
+        break;
+    case TokenType::MINUS:
+        v = a - b;
+        break;
+    case TokenType::STAR:
+        v = a * b;
+        break;
+    case TokenType::SLASH:
+    case TokenType::PERCENT:
+        if (b == 0)
+            exit_with("in constant expression", "division by zero");
+        v = op == TokenType::SLASH ? a / b : a % b;
+        break;
+    case TokenType::BIT_AND:
+        v = a & b;
+        break;
+    case TokenType::BIT_OR:
+        v = a | b;
+        break;
+    case TokenType::BIT_XOR:
+        v = a ^ b;
+        break;
+    default:
+        return {};
+    }
+
+    // bool & bool
+    if (!t.is_integer())
+        return v;
+
+    // an overflow of int or i64 is undefined in c++, the narrower integers and the unsigned ones wrap around
+    if (t.bits() >= 32 && !t.is_unsigned() && (v < t.min() || v > static_cast<__int128>(t.max())))
+        exit_with("in constant expression of type " + to_string(t), "integer overflow");
+
+    return wrap(v, t);
+}
+
+VarType::VarType(Kind kind)
+    : kind(kind) {
+}
+
+VarType VarType::array_of(const VarType& elem, size_t size) {
+    VarType t(Kind::ARRAY);
+    t.elem = std::make_shared<VarType>(elem);
+    t.size = size;
+    return t;
+}
+
+VarType VarType::list_of(const VarType& elem) {
+    VarType t(Kind::LIST);
+    t.elem = std::make_shared<VarType>(elem);
+    return t;
+}
+
+VarType VarType::map_of(const VarType& key, const VarType& value) {
+    VarType t(Kind::MAP);
+    t.key = std::make_shared<VarType>(key);
+    t.elem = std::make_shared<VarType>(value);
+    return t;
+}
+
+VarType VarType::struct_of(const std::string& name) {
+    VarType t(Kind::STRUCT);
+    t.name = name;
+    return t;
+}
+
+VarType VarType::enum_of(const std::string& name) {
+    VarType t(Kind::ENUM);
+    t.name = name;
+    return t;
+}
+
+bool VarType::is_container() const {
+    return kind == Kind::ARRAY || kind == Kind::LIST;
+}
+
+bool VarType::is_integer() const {
+    return bits() > 0;
+}
+
+bool VarType::is_numeric() const {
+    return is_integer() || kind == Kind::FLOAT || kind == Kind::DOUBLE;
+}
+
+bool VarType::is_scalar() const {
+    return kind == Kind::BOOL || kind == Kind::CHAR || is_numeric() || is_vector() || kind == Kind::ENUM;
+}
+
+bool VarType::is_unsigned() const {
+    return kind == Kind::U8 || kind == Kind::U16 || kind == Kind::U32 || kind == Kind::U64;
+}
+
+int VarType::bits() const {
+    switch (kind) {
+    case Kind::I8:
+    case Kind::U8:
+        return 8;
+    case Kind::I16:
+    case Kind::U16:
+        return 16;
+    case Kind::INT:
+    case Kind::U32:
+        return 32;
+    case Kind::I64:
+    case Kind::U64:
+        return 64;
+    default:
+        return 0;
+    }
+}
+
+long long VarType::min() const {
+    if (is_unsigned())
+        return 0;
+    if (bits() == 64)
+        return std::numeric_limits<long long>::min();
+    return -(1LL << (bits() - 1));
+}
+
+unsigned long long VarType::max() const {
+    if (bits() == 64)
+        return is_unsigned() ? std::numeric_limits<unsigned long long>::max() : std::numeric_limits<long long>::max();
+    return is_unsigned() ? (1ULL << bits()) - 1 : (1ULL << (bits() - 1)) - 1;
+}
+
+bool VarType::is_vector() const {
+    return kind == Kind::VEC2 || kind == Kind::VEC3 || kind == Kind::VEC4;
+}
+
+size_t VarType::lanes() const {
+    switch (kind) {
+    case Kind::VEC2:
+        return 2;
+    case Kind::VEC3:
+        return 3;
+    case Kind::VEC4:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+bool VarType::operator==(const VarType& other) const {
+    if (kind != other.kind || size != other.size || name != other.name || soa != other.soa)
+        return false;
+    if (key && other.key && *key != *other.key)
+        return false;
+    if (elem && other.elem)
+        return *elem == *other.elem;
+    return elem == other.elem;
+}
+
+std::string to_string(const VarType& t) {
+    switch (t.kind) {
+    case VarType::VOID:
+        return "void";
+    case VarType::BOOL:
+        return "bool";
+    case VarType::INT:
+        return "int";
+    case VarType::I8:
+        return "i8";
+    case VarType::I16:
+        return "i16";
+    case VarType::I64:
+        return "i64";
+    case VarType::U8:
+        return "u8";
+    case VarType::U16:
+        return "u16";
+    case VarType::U32:
+        return "u32";
+    case VarType::U64:
+        return "u64";
+    case VarType::CHAR:
+        return "char";
+    case VarType::STRING:
+        return "string";
+    case VarType::FLOAT:
+        return "float";
+    case VarType::DOUBLE:
+        return "double";
+    case VarType::VEC2:
+        return "vec2";
+    case VarType::VEC3:
+        return "vec3";
+    case VarType::VEC4:
+        return "vec4";
+    case VarType::STRUCT:
+    case VarType::ENUM:
+        return t.name;
+    case VarType::ARRAY:
+        return to_string(*t.elem) + "[" + std::to_string(t.size) + "]" + (t.soa ? " @soa" : "");
+    case VarType::LIST:
+        return "list<" + to_string(*t.elem) + ">";
+    case VarType::MAP:
+        return "map<" + to_string(*t.key) + ", " + to_string(*t.elem) + ">";
+    case VarType::BYTES:
+        return "bytes";
+    case VarType::STR_VIEW:
+        return "str_view";
+    default:
+        return "auto";
+    }
+}
+
+VarType to_variable_type(TokenType t) {
+    switch (t) {
+    case TokenType::TYPE_BOOL:
+    case TokenType::BOOLEAN_LITEARL:
+        return VarType::BOOL;
+    case TokenType::TYPE_INT:
+    case TokenType::INTEGER_LITERAL:
+        return VarType::INT;
+    case TokenType::TYPE_I8:
+        return VarType::I8;
+    case TokenType::TYPE_I16:
+        return VarType::I16;
+    case TokenType::TYPE_I64:
+        return VarType::I64;
+    case TokenType::TYPE_U8:
+        return VarType::U8;
+    case TokenType::TYPE_U16:
+        return VarType::U16;
+    case TokenType::TYPE_U32:
+        return VarType::U32;
+    case TokenType::TYPE_U64:
+        return VarType::U64;
+    case TokenType::TYPE_CHAR:
+    case TokenType::CHAR_LITERAL:
+        return VarType::CHAR;
+    case TokenType::TYPE_STRING:
+    case TokenType::STRING_LITERAL:
+        return VarType::STRING;
+    case TokenType::TYPE_BYTES:
+        return VarType::BYTES;
+    case TokenType::TYPE_STR_VIEW:
+        return VarType::STR_VIEW;
+    case TokenType::TYPE_FLOAT:
+    case TokenType::FLOAT_LITERAL:
+        return VarType::FLOAT;
+    case TokenType::TYPE_DOUBLE:
+    case TokenType::DOUBLE_LITERAL:
+        return VarType::DOUBLE;
+    case TokenType::TYPE_VEC2:
+        return VarType::VEC2;
+    case TokenType::TYPE_VEC3:
+        return VarType::VEC3;
+    case TokenType::TYPE_VEC4:
+        return VarType::VEC4;
+    default:
+        return VarType::VOID;
+    }
+}
+
+Parser::Parser(std::vector<Token> tokens, std::unordered_map<std::string, const module::Interface*> imports)
+    : tokens(std::move(tokens)), allocator(1024 * 1024 * 4), imports(std::move(imports)) {
+} // 4mb
+
+std::optional<Parser::ConstValue> Parser::constant(const std::string& ident) const {
+    const auto it = constants.find(ident);
+    if (it == constants.end())
+        return {};
+    return it->second;
+}
+
+bool Parser::writes_globals(const std::string& func) const {
+    return global_writers.count(func);
+}
+
+size_t Parser::node_count() const {
+    return allocator.num_allocs();
+}
+
+const ArenaAllocator& Parser::arena() const {
+    return allocator;
+}
+
+std::optional<VarType> Parser::var_type(const std::string& ident) {
+    if (is_var(ident))
+        return identifiers[ident];
+    return {};
+}
+
+std::optional<Token> Parser::peek(const int offset) const {
+    if (index + offset >= tokens.size())
+        return {};
+    return tokens.at(index + offset);
+}
+
+bool Parser::peek_type(TokenType type, int offset) const {
+    return peek(offset).has_value() && peek(offset).value().type == type;
+}
+
+Token Parser::consume() {
+    //std::cout << to_string(tokens[index].type) << std::endl;
+    return tokens[index++];
+}
+
+Token Parser::try_consume_err(TokenType type) {
+    if (peek().has_value() && peek().value().type == type) {
+        return consume();
+    }
+    else {
+        exit_with("`" + to_string(type) + "`");
+        return {}; // unreachable
+    }
+}
+
+std::optional<Token> Parser::try_consume(TokenType type) {
+    if (peek().has_value() && peek().value().type == type) {
+        return consume();
+    }
+    else {
+        return {};
+    }
+}
+
+void Parser::exit_with(const std::string& err_msg, std::string template_msg) {
+    std::cerr << "[Error] " << template_msg << " " << err_msg << " on line ";
+
+    if (peek().has_value())
+        std::cerr << peek().value().line;
+    else
+        std::cerr << peek(-1).value().line;
+
+    std::cerr << std::endl;
+
+    exit(EXIT_FAILURE);
+}
+
+/* ----- PARSING FUNCTIONS ----- */
+
+std::optional<Node::Prog> Parser::parse_prog() {
+    Node::Prog prog;
+
+    while (peek().has_value()) {
+        const std::optional<Token> ident = peek(1);
+        trace::Span span("parse " + to_string(peek().value().type), ident.has_value() ? ident.value().val.value_or("") : "");
+
+        if (std::optional<Node::ProgStmt*> stmt = parse_prog_stmt()) {
+            prog.stmts.push_back(stmt.value());
+        }
+        else {
+            exit_with("statement");
+        }
+    }
+
+    return prog;
+};
+
+std::optional<Node::ProgStmt*> Parser::parse_prog_stmt() {
+    // IMPORT "FILE"
+    if (const auto imp = parse_import()) {
+        return allocator.emplace<Node::ProgStmt>(imp.value());
+    }
+
+    // STRUCT IDENT { ? }
+    if (const auto st = parse_struct()) {
+        return allocator.emplace<Node::ProgStmt>(st.value());
+    }
+
+    // ENUM IDENT { ? }
+    if (const auto en = parse_enum()) {
+        return allocator.emplace<Node::ProgStmt>(en.value());
+    }
+
+    // VAR IDENT ?
+    if (const auto var = parse_var_declaration()) {
+        return std::visit([&](auto* v) { return allocator.emplace<Node::ProgStmt>(v); }, var.value());
+    }
+
+    // CONST IDENT = ?
+    if (const auto stmt_const = parse_const()) {
+        return allocator.emplace<Node::ProgStmt>(stmt_const.value());
+    }
+
+    // FUNC IDENT() ?
+    if (peek_type(TokenType::FUNC)) {
+        consume();
+
+        auto func = allocator.emplace<Node::FuncDeclaration>();
+        func->ident = try_consume_err(TokenType::IDENTIFIER);
+
+        // also a function of an imported module
+        const std::string& name = func->ident.val.value();
+        if (is_var(name) || structs.count(name) || enums.count(name))
+            exit_with("'" + name + "' already used", "identifier");
+
+        // the parameters are only visible in the body of the function
+        begin_scope();
+        current_func = func->ident.val.value();
+
+        func->params = parse_params();
+
+        if (func->ident.val.value() == "main" && !func->params.empty())
+            exit_with("parameters", "function `main` cannot take");
+
+        functions[func->ident.val.value()] = func;
+
+        if (peek_type(TokenType::COLON)) {
+            consume(); // :
+
+            if (const auto t = parse_type())
+                func->type = t.value();
+            else
+                exit_with("type specifier");
+
+            // the return type is known, register the function now so it can call itself
+            identifiers[func->ident.val.value()] = func->type;
+            return_type = func->type;
+
+            if (const auto s = parse_scope()) {
+                func->scope = s.value();
+            }
+            else {
+                exit_with("scope");
+                return {}; // unreachable
+            }
+
+            if (func->type != func->scope->type)
+                exit_with(func->ident.val.value() + " is of type " + to_string(func->type), "function");
+
+            check_parallel_self_call();
+
+            return_type.reset();
+            current_func.reset();
+            end_scope();
+
+            return allocator.emplace<Node::ProgStmt>(func);
+        }
+
+        if (const auto s = parse_scope()) {
+            func->scope = s.value();
+        }
+        else {
+            exit_with("scope");
+            return {}; // unreachable
+        }
+
+        check_parallel_self_call();
+
+        current_func.reset();
+        end_scope();
+
+        func->type = func->scope->type;
+
+        identifiers[func->ident.val.value()] = func->type;
+
+        return allocator.emplace<Node::ProgStmt>(func);
+    }
+
+    return {};
+}
+
+std::optional<Node::Import*> Parser::parse_import() {
+    if (!try_consume(TokenType::IMPORT))
+        return {};
+
+    auto imp = allocator.emplace<Node::Import>();
+    imp->path = try_consume_err(TokenType::STRING_LITERAL);
+
+    // every module is built by the driver before the program importing it is parsed
+    import_module(imports.at(imp->path.val.value()), imp->decls);
+
+    return imp;
+}
+
+void Parser::import_module(const module::Interface* m, std::vector<Node::ProgStmt*>& decls) {
+    if (!imported.insert(m).second)
+        return;
+
+    for (const module::Interface* dep : m->imports)
+        import_module(dep, decls);
+
+    const auto check_unused = [&](const Token& ident) {
+        const std::string& name = ident.val.value();
+        if (is_var(name) || structs.count(name) || enums.count(name))
+            exit_with("'" + name + "' already used (declared by the module " + m->path + ")", "identifier");
+    };
+
+    for (Node::ProgStmt* s : m->decls) {
+        if (const auto st = std::get_if<Node::StructDeclaration*>(&s->var)) {
+            check_unused((*st)->ident);
+            structs[(*st)->ident.val.value()] = *st;
+        }
+        else if (const auto en = std::get_if<Node::EnumDeclaration*>(&s->var)) {
+            check_unused((*en)->ident);
+            enums[(*en)->ident.val.value()] = *en;
+        }
+        else if (const auto c = std::get_if<Node::StmtConst*>(&s->var)) {
+            const std::string& name = (*c)->ident.val.value();
+            check_unused((*c)->ident);
+            declare((*c)->ident, (*c)->type);
+            immutables[name] = "constant '" + name + "'";
+            constants[name] = m->constants.at(name);
+        }
+        else if (const auto func = std::get_if<Node::FuncDeclaration*>(&s->var)) {
+            const std::string& name = (*func)->ident.val.value();
+            check_unused((*func)->ident);
+            functions[name] = *func;
+            identifiers[name] = (*func)->type;
+            if (m->global_writers.count(name))
+                global_writers.insert(name);
+        }
+
+        decls.push_back(s);
+    }
+}
+
+std::optional<Node::StructDeclaration*> Parser::parse_struct() {
+    if (!try_consume(TokenType::STRUCT))
+        return {};
+
+    auto st = allocator.emplace<Node::StructDeclaration>();
+    st->ident = try_consume_err(TokenType::IDENTIFIER);
+
+    const std::string& name = st->ident.val.value();
+    if (is_var(name) || structs.count(name) || enums.count(name))
+        exit_with("'" + name + "' already used", "identifier");
+
+    try_consume_err(TokenType::LEFT_CURLY_BACKET);
+
+    while (const auto ident = try_consume(TokenType::IDENTIFIER)) {
+        for (const Node::Field* f : st->fields) {
+            if (f->ident.val.value() == ident.value().val.value())
+                exit_with("'" + ident.value().val.value() + "'", "duplicate field");
+        }
+
+        try_consume_err(TokenType::COLON);
+
+        auto f = allocator.emplace<Node::Field>(ident.value());
+        if (const auto t = parse_type())
+            f->type = t.value();
+        else
+            exit_with("type specifier");
+
+        check_storable(f->type, "a struct");
+
+        st->fields.push_back(f);
+    }
+
+    if (st->fields.empty())
+        exit_with("field", "expected at least one");
+
+    try_consume_err(TokenType::RIGHT_CURLY_BRACKET);
+
+    // registered after its fields, a struct cannot contain itself
+    structs[name] = st;
+
+    return st;
+}
+
+std::optional<Node::EnumDeclaration*> Parser::parse_enum() {
+    if (!try_consume(TokenType::ENUM))
+        return {};
+
+    auto en = allocator.emplace<Node::EnumDeclaration>();
+    en->ident = try_consume_err(TokenType::IDENTIFIER);
+
+    const std::string& name = en->ident.val.value();
+    if (is_var(name) || structs.count(name) || enums.count(name))
+        exit_with("'" + name + "' already used", "identifier");
+
+    try_consume_err(TokenType::LEFT_CURLY_BACKET);
+
+    do {
+        const Token value = try_consume_err(TokenType::IDENTIFIER);
+
+        for (const Token& v : en->values) {
+            if (v.val.value() == value.val.value())
+                exit_with("'" + value.val.value() + "'", "duplicate enum value");
+        }
+
+        en->values.push_back(value);
+    } while (try_consume(TokenType::COMMA));
+
+    try_consume_err(TokenType::RIGHT_CURLY_BRACKET);
+
+    enums[name] = en;
+
+    return en;
+}
+
+std::vector<Node::Param*> Parser::parse_params() {
+    std::vector<Node::Param*> params;
+
+    try_consume_err(TokenType::LEFT_PARENTHESIS);
+
+    if (try_consume(TokenType::RIGHT_PARENTHESIS))
+        return params;
+
+    do {
+        auto param = allocator.emplace<Node::Param>();
+        param->ref = try_consume(TokenType::REF).has_value();
+        param->ident = try_consume_err(TokenType::IDENTIFIER);
+
+        try_consume_err(TokenType::COLON);
+
+        if (const auto t = parse_type())
+            param->type = t.value();
+        else
+            exit_with("type specifier");
+
+        if (param->ref)
+            check_storable(param->type, "a `ref` parameter");
+
+        declare(param->ident, param->type);
+        if (!param->ref)
+            immutables[param->ident.val.value()] = "parameter '" + param->ident.val.value() + "' (add `ref` to modify it)";
+
+        params.push_back(param);
+    } while (try_consume(TokenType::COMMA));
+
+    try_consume_err(TokenType::RIGHT_PARENTHESIS);
+
+    return params;
+}
+
+std::optional<Node::Scope*> Parser::parse_scope() {
+    if (!try_consume(TokenType::LEFT_CURLY_BACKET).has_value())
+        return {};
+
+    auto scope = allocator.emplace<Node::Scope>();
+
+    begin_scope();
+
+    while (auto stmt = parse_scope_stmt()) {
+        scope->stmts.push_back(stmt.value());
+
+        if (stmt.value()->type.has_value())
+            scope->type = stmt.value()->type.value();
+    }
+
+    try_consume_err(TokenType::RIGHT_CURLY_BRACKET);
+
+    end_scope();
+
+    return scope;
+}
+
+std::optional<Node::ScopeStmt*> Parser::parse_scope_stmt() {
+    if (!peek().has_value())
+        return {};
+
+
+    // ? ++
+    if (peek_type(TokenType::INCREMENTATOR, 1)) {
+        auto incr = allocator.emplace<Node::VarIncr>();
+
+        if (const auto id = parse_identifier()) {
+            incr->ident = id.value();
+        }
+        else exit_with("int expression");
+
+        if (!incr->ident->type.is_integer())
+            exit_with("integer", "type expression must be");
+        check_mutable(incr->ident->ident);
+
+        consume(); // ++
+
+        auto s = allocator.emplace<Node::ScopeStmt>(incr);
+        s->type = incr->ident->type;
+        return s;
+    }
+
+    // ? --
+    if (peek_type(TokenType::DECREMENTATOR, 1)) {
+        auto decr = allocator.emplace<Node::VarDecr>();
+
+        if (const auto id = parse_identifier()) {
+            decr->ident = id.value();
+        }
+        else exit_with("int expression");
+
+        if (!decr->ident->type.is_integer())
+            exit_with("integer", "type expression must be");
+        check_mutable(decr->ident->ident);
+
+        consume(); // --
+
+        auto s = allocator.emplace<Node::ScopeStmt>(decr);
+        s->type = decr->ident->type;
+        return s;
+    }
+
+    // RETURN ?
+    if (peek_type(TokenType::RETURN)) {
+        if (parallel.has_value())
+            exit_with("return", "parallel for cannot");
+        if (bench_depth > 0)
+            exit_with("return", "bench cannot");
+        consume();
+        Node::StmtReturn* ret = allocator.emplace<Node::StmtReturn>();
+
+        if (auto ne = parse_expr())
+            ret->expr = ne.value();
+        else
+            exit_with("return value");
+
+        if (return_type.has_value())
+            coerce_literal(ret->expr, return_type.value());
+
+        // a view returned can point into the parameters and the globals, not into the locals
+        if (ret->expr->type.kind == VarType::STR_VIEW)
+            check_view_lifetime(ret->expr, 1, "");
+
+        Node::ScopeStmt* stmt = allocator.emplace<Node::ScopeStmt>(ret);
+        stmt->type = ret->expr->type;
+
+        return stmt;
+    }
+
+    // VAR IDENT ?
+    if (const auto var = parse_var_declaration()) {
+        return std::visit([&](auto* v) { return allocator.emplace<Node::ScopeStmt>(v); }, var.value());
+    }
+
+    // CONST IDENT = ?
+    if (const auto stmt_const = parse_const()) {
+        return allocator.emplace<Node::ScopeStmt>(stmt_const.value());
+    }
+
+    // IDENT = ?
+    if (peek_type(TokenType::IDENTIFIER) && peek_type(TokenType::EQUAL, 1)) {
+        auto var_assign = allocator.emplace<Node::StmtVarAssign>();
+        var_assign->ident = consume();
+
+        if (!is_var(var_assign->ident.val.value())) {
+            exit_with("'" + var_assign->ident.val.value() + "'", "unknown identifier");
+        }
+
+        check_mutable(var_assign->ident);
+
+        consume(); // = token
+
+        if (const auto expr = parse_expr()) {
+            var_assign->expr = expr.value();
+        }
+        else
+            exit_with("expression");
+
+        const std::string& name = var_assign->ident.val.value();
+
+        coerce_literal(var_assign->expr, identifiers[name]);
+
+        if (!converts(var_assign->expr->type, identifiers[name])) {
+            exit_with(to_string(var_assign->expr->type), "wrong type ");
+        }
+
+        // the view may point into any of the strings it was assigned
+        if (identifiers[name].kind == VarType::STR_VIEW) {
+            const std::vector<std::string> roots = check_view_lifetime(var_assign->expr, scope_depth(name), name);
+            view_roots[name].insert(view_roots[name].end(), roots.begin(), roots.end());
+        }
+
+        return allocator.emplace<Node::ScopeStmt>(var_assign);
+    }
+
+    // IDENT[ ? ] = ? or IDENT.FIELD = ?
+    if (peek_type(TokenType::IDENTIFIER) && (peek_type(TokenType::LEFT_SQUARE_BRACKET, 1) || peek_type(TokenType::DOT, 1))) {
+        auto elem_assign = allocator.emplace<Node::StmtElemAssign>();
+
+        if (const auto target = parse_term())
+            elem_assign->target = target.value();
+        else
+            exit_with("expression");
+
+        if (!std::holds_alternative<Node::TermIndex*>(elem_assign->target->var) &&
+            !std::holds_alternative<Node::TermField*>(elem_assign->target->var))
+            exit_with("element or field", "expected");
+
+        check_mutable(elem_assign->target);
+
+        try_consume_err(TokenType::EQUAL);
+
+        if (const auto expr = parse_expr()) {
+            elem_assign->expr = expr.value();
+        }
+        else
+            exit_with("expression");
+
+        coerce_literal(elem_assign->expr, elem_assign->target->type);
+
+        if (elem_assign->target->type != elem_assign->expr->type)
+            exit_with(to_string(elem_assign->expr->type), "wrong type ");
+
+        return allocator.emplace<Node::ScopeStmt>(elem_assign);
+    }
+
+    // IDENT( ? )
+    if (const auto fcall = parse_func_call()) {
+        return allocator.emplace<Node::ScopeStmt>(fcall.value());
+    }
+
+    // { ? }
+    if (peek_type(TokenType::LEFT_CURLY_BACKET)) {
+        if (auto scope = parse_scope()) {
+            auto stmt = allocator.emplace<Node::ScopeStmt>(scope.value());
+            return stmt;
+        }
+        else
+            exit_with("scope");
+    }
+
+    // FOR IDENT IN ?..? STEP ? { ? }
+    if (const auto stmt_for = parse_for()) {
+        return allocator.emplace<Node::ScopeStmt>(stmt_for.value());
+    }
+
+    // MATCH ( ? ) { ? => { ? } }
+    if (const auto stmt_match = parse_match()) {
+        return allocator.emplace<Node::ScopeStmt>(stmt_match.value());
+    }
+
+    // PARALLEL FOR IDENT IN ?..? { ? }
+    if (const auto stmt_parallel_for = parse_parallel_for()) {
+        return allocator.emplace<Node::ScopeStmt>(stmt_parallel_for.value());
+    }
+
+    // FRAME { ? }
+    if (const auto stmt_frame = parse_frame()) {
+        return allocator.emplace<Node::ScopeStmt>(stmt_frame.value());
+    }
+
+    // BENCH ( ? ) { ? }
+    if (const auto stmt_bench = parse_bench()) {
+        return allocator.emplace<Node::ScopeStmt>(stmt_bench.value());
+    }
+
+    // WHILE ( ? ) { ? }
+    if (const auto twhile = try_consume(TokenType::WHILE)) {
+        try_consume_err(TokenType::LEFT_PARENTHESIS);
+
+        auto stmt_while = allocator.emplace<Node::StmtWhile>();
+
+        if (const auto expr = parse_expr()) {
+            stmt_while->expr = expr.value();
+        }
+        else
+            exit_with("expression");
+
+        try_consume_err(TokenType::RIGHT_PARENTHESIS);
+
+        if (const auto scope = parse_scope()) {
+            stmt_while->scope = scope.value();
+        }
+        else
+            exit_with("scope");
+
+        return allocator.emplace<Node::ScopeStmt>(stmt_while);
+    }
+
+    // IF ( ? ) { ? } ?
+    if (const auto tif = try_consume(TokenType::IF)) {
+        try_consume_err(TokenType::LEFT_PARENTHESIS);
+
+        auto stmt_if = allocator.emplace<Node::StmtIf>();
+
+        if (const auto expr = parse_expr()) {
+            stmt_if->expr = expr.value();
+        }
+        else
+            exit_with("expression");
+
+        try_consume_err(TokenType::RIGHT_PARENTHESIS);
+
+        if (const auto scope = parse_scope()) {
+            stmt_if->scope = scope.value();
+        }
+        else
+            exit_with("scope");
+
+        stmt_if->pred = parse_if_pred();
+
+        auto stmt = allocator.emplace<Node::ScopeStmt>(stmt_if);
+        return stmt;
+    }
 
-std::optional<VarType> Parser::var_type(const std::string& ident) {
-    if (is_var(ident))
-        return identifiers[ident];
     return {};
 }
 
-std::optional<Token> Parser::peek(const int offset) const {
-    if (index + offset >= tokens.size())
+std::optional<std::variant<Node::StmtImplicitVar*, Node::StmtExplicitVar*>> Parser::parse_var_declaration() {
+    if (!peek_type(TokenType::VAR))
         return {};
-    return tokens.at(index + offset);
-}
 
-bool Parser::peek_type(TokenType type, int offset) const {
-    return peek(offset).has_value() && peek(offset).value().type == type;
-}
+    consume(); // var
 
-Token Parser::consume() {
-    //std::cout << to_string(tokens[index].type) << std::endl;
-    return tokens[index++];
-}
+    const Token ident = try_consume_err(TokenType::IDENTIFIER);
 
-Token Parser::try_consume_err(TokenType type) {
-    if (peek().has_value() && peek().value().type == type) {
-        return consume();
+    if (is_var(ident.val.value()))
+        exit_with("'" + ident.val.value() + "' already used", "identifier");
+
+    std::optional<VarType> type;
+
+    // VAR IDENT : TYPE ?
+    if (try_consume(TokenType::COLON)) {
+        type = parse_type();
+        if (!type.has_value())
+            exit_with("type");
     }
-    else {
-        exit_with("`" + to_string(type) + "`");
-        return {}; // unreachable
+
+    // VAR IDENT : TYPE
+    if (!peek_type(TokenType::EQUAL)) {
+        if (!type.has_value())
+            exit_with("type declaration");
+
+        Node::StmtExplicitVar* var = allocator.emplace<Node::StmtExplicitVar>(ident, type.value());
+        var->frame = frame_depth > 0 && var->type.kind == VarType::LIST;
+        if (var->type.kind == VarType::STR_VIEW)
+            view_roots[ident.val.value()] = {};
+        declare(ident, var->type);
+        return var;
     }
-}
 
-std::optional<Token> Parser::try_consume(TokenType type) {
-    if (peek().has_value() && peek().value().type == type) {
-        return consume();
+    consume(); // =
+
+    // VAR IDENT = ? or VAR IDENT : TYPE = ?
+    Node::StmtImplicitVar* var = allocator.emplace<Node::StmtImplicitVar>();
+    var->identifier = ident;
+
+    if (auto e = parse_expr()) {
+        var->expr = e.value();
     }
     else {
-        return {};
+        exit_with("expression");
     }
-}
 
-void Parser::exit_with(const std::string& err_msg, std::string template_msg) {
-    std::cerr << "[Error] " << template_msg << " " << err_msg << " on line ";
+    if (type.has_value())
+        coerce_literal(var->expr, type.value());
 
-    if (peek().has_value())
-        std::cerr << peek().value().line;
-    else
-        std::cerr << peek(-1).value().line;
+    if (type.has_value() && !converts(var->expr->type, type.value()))
+        exit_with(to_string(type.value()), "variable type must be");
 
-    std::cerr << std::endl;
+    var->type = type.value_or(var->expr->type);
 
-    exit(EXIT_FAILURE);
+    // declared in the innermost scope, the strings it points into are already declared so they outlive it
+    if (var->type.kind == VarType::STR_VIEW)
+        view_roots[ident.val.value()] = check_view_lifetime(var->expr, scopes.size(), ident.val.value());
+
+    declare(ident, var->type);
+
+    return var;
 }
 
-/* ----- PARSING FUNCTIONS ----- */
+std::optional<Node::StmtConst*> Parser::parse_const() {
+    if (!try_consume(TokenType::CONST))
+        return {};
 
-std::optional<Node::Prog> Parser::parse_prog() {
-    Node::Prog prog;
+    auto stmt = allocator.emplace<Node::StmtConst>();
+    stmt->ident = try_consume_err(TokenType::IDENTIFIER);
 
-    while (peek().has_value()) {
-        if (std::optional<Node::ProgStmt*> stmt = parse_prog_stmt()) {
-            prog.stmts.push_back(stmt.value());
-        }
-        else {
-            exit_with("statement");
-        }
-    }
+    const std::string& name = stmt->ident.val.value();
 
-    return prog;
-};
+    std::optional<VarType> type;
 
-std::optional<Node::ProgStmt*> Parser::parse_prog_stmt() {
-    // VAR IDENT ?
-    if (peek_type(TokenType::VAR) && peek_type(TokenType::IDENTIFIER, 1)) {
-        // VAR IDENT = ?
-        if (peek_type(TokenType::EQUAL, 2)) {
-            consume(); // var
+    // CONST IDENT : TYPE = ?
+    if (try_consume(TokenType::COLON)) {
+        type = parse_type();
+        if (!type.has_value())
+            exit_with("type");
+    }
 
-            Node::StmtImplicitVar* var = allocator.emplace<Node::StmtImplicitVar>();
-            var->identifier = consume();
+    try_consume_err(TokenType::EQUAL);
 
-            if (is_var(var->identifier.val.value()))
-                exit_with("'" + var->identifier.val.value() + "' already used", "identifier");
+    if (const auto e = parse_expr())
+        stmt->expr = e.value();
+    else
+        exit_with("expression");
 
-            consume(); // =
+    if (type.has_value())
+        coerce_literal(stmt->expr, type.value());
 
-            if (auto e = parse_expr()) {
-                var->expr = e.value();
-            }
-            else {
-                exit_with("expression");
-            }
+    if (type.has_value() && stmt->expr->type != type.value())
+        exit_with(to_string(type.value()), "constant type must be");
 
-            identifiers[var->identifier.val.value()] = var->expr->type;
+    stmt->type = stmt->expr->type;
 
-            Node::ProgStmt* stmt = allocator.emplace<Node::ProgStmt>(var);
-            return stmt;
-        }
-        // VAR IDENT : TYPE = ?
-        else if (peek_type(TokenType::COLON, 2) && peek_type(TokenType::EQUAL, 4)) {
-            consume(); // var
+    const VarType& t = stmt->type;
+    if (t.kind != VarType::BOOL && t.kind != VarType::CHAR && !t.is_numeric())
+        exit_with("a bool, a char or a number, not " + to_string(t), "constant '" + name + "' must be");
 
-            Node::StmtImplicitVar* var = allocator.emplace<Node::StmtImplicitVar>();
-            var->identifier = consume();
+    const auto value = fold(stmt->expr);
+    if (!value.has_value())
+        exit_with("'" + name + "' must be known at compile time (only literals, constants and operators)", "constant");
 
-            if (is_var(var->identifier.val.value()))
-                exit_with("'" + var->identifier.val.value() + "' already used", "identifier");
+    declare(stmt->ident, t);
+    immutables[name] = "constant '" + name + "'";
+    constants[name] = value.value();
 
-            consume(); // :
-            Token type = consume();
-            consume(); // =
+    return stmt;
+}
 
-            if (auto e = parse_expr()) {
-                var->expr = e.value();
-            }
-            else {
-                exit_with("expression");
-            }
+std::optional<Node::FuncCall*> Parser::parse_func_call() {
+    if (!peek_type(TokenType::IDENTIFIER) || !peek_type(TokenType::LEFT_PARENTHESIS, 1))
+        return {};
 
-            if (var->expr->type != to_variable_type(type.type))
-                exit_with(to_string(type.type), "variable type must be");
+    auto fcall = allocator.emplace<Node::FuncCall>();
+    fcall->ident = consume();
 
-            identifiers[var->identifier.val.value()] = var->expr->type;
+    consume(); // ( token
 
-            Node::ProgStmt* stmt = allocator.emplace<Node::ProgStmt>(var);
-            return stmt;
-        }
-        // VAR IDENT : TYPE
-        else if (peek_type(TokenType::COLON, 2)) {
-            consume(); // var
-            Node::StmtExplicitVar* var = allocator.emplace<Node::StmtExplicitVar>();
-            var->ident = consume();
+    fcall->args = parse_args();
 
-            if (is_var(var->ident.val.value()))
-                exit_with("'" + var->ident.val.value() + "' already used", "identifier");
+    try_consume_err(TokenType::RIGHT_PARENTHESIS);
 
-            consume(); // :
+    if (is_buildin_func(fcall->ident.val.value())) {
+        fcall->type = buildin_call_type(fcall);
+    }
+    else if (const auto t = var_type(fcall->ident.val.value())) {
+        fcall->type = t.value();
+    }
+    else
+        exit_with(fcall->ident.val.value(), "unknown identifier");
 
-            if (auto t = parse_type()) {
-                var->type = t.value();
-            }
-            else {
-                exit_with("type");
-            }
+    if (functions.count(fcall->ident.val.value())) {
+        check_args(fcall);
 
-            identifiers[var->ident.val.value()] = var->type;
+        // a call to the function being parsed may write to the globals it writes to further down
+        if (global_writers.count(fcall->ident.val.value()) || fcall->ident.val.value() == current_func)
+            check_no_global_view(fcall);
 
-            Node::ProgStmt* stmt = allocator.emplace<Node::ProgStmt>(var);
-            return stmt;
+        if (parallel.has_value() && fcall->ident.val.value() == current_func && !parallel_self_call.has_value())
+            parallel_self_call = fcall->ident.line;
+
+        if (global_writers.count(fcall->ident.val.value())) {
+            if (parallel.has_value())
+                exit_with("`" + fcall->ident.val.value() + "`, it writes to global variables", "parallel for cannot call");
+            if (current_func.has_value())
+                global_writers.insert(current_func.value());
         }
-        else
-            exit_with("type declaration");
     }
 
-    // FUNC IDENT() ?
-    if (peek_type(TokenType::FUNC)) {
-        consume();
-
-        auto func = allocator.alloc<Node::FuncDeclaration>();
-        func->ident = try_consume_err(TokenType::IDENTIFIER);
+    return fcall;
+}
 
-        try_consume_err(TokenType::LEFT_PARENTHESIS);
-        try_consume_err(TokenType::RIGHT_PARENTHESIS);
+std::vector<Node::Expr*> Parser::parse_args() {
+    std::vector<Node::Expr*> args{};
 
-        if (peek_type(TokenType::COLON)) {
-            consume(); // :
+    if (const auto e = parse_expr()) {
+        args.push_back(e.value());
 
-            if (const auto t = parse_type())
-                func->type = t.value();
+        while (const auto comma = try_consume(TokenType::COMMA)) {
+            if (const auto e = parse_expr()) {
+                args.push_back(e.value());
+            }
             else
-                exit_with("type specifier");
+                exit_with("expression");
+        }
+    }
 
-            if (const auto s = parse_scope()) {
-                func->scope = s.value();
-            }
-            else {
-                exit_with("scope");
-                return {}; // unreachable
-            }
+    return args;
+}
 
-            if (func->type != func->scope->type)
-                exit_with(func->ident.val.value() + " is of type " + to_string(func->type), "function");
+Node::Range* Parser::parse_range() {
+    auto range = allocator.emplace<Node::Range>();
 
-            identifiers[func->ident.val.value()] = func->type;
+    if (const auto begin = parse_expr())
+        range->begin = begin.value();
+    else
+        exit_with("range start");
 
-            return allocator.emplace<Node::ProgStmt>(func);
-        }
+    try_consume_err(TokenType::RANGE);
 
-        if (const auto s = parse_scope()) {
-            func->scope = s.value();
-        }
-        else {
-            exit_with("scope");
-            return {}; // unreachable
-        }
+    if (const auto end = parse_expr())
+        range->end = end.value();
+    else
+        exit_with("range end");
 
-        func->type = func->scope->type;
+    coerce_literal(range->begin, range->end->type, false);
+    coerce_literal(range->end, range->begin->type, false);
 
-        identifiers[func->ident.val.value()] = func->type;
+    if (!range->begin->type.is_integer() || !range->end->type.is_integer())
+        exit_with("integers", "range bounds must be");
 
-        return allocator.emplace<Node::ProgStmt>(func);
-    }
+    range->type = promote(range->begin->type, range->end->type);
 
-    return {};
+    return range;
 }
 
-std::optional<Node::Scope*> Parser::parse_scope() {
-    if (!try_consume(TokenType::LEFT_CURLY_BACKET).has_value())
+std::optional<Node::StmtFor*> Parser::parse_for() {
+    if (!try_consume(TokenType::FOR))
         return {};
 
-    auto scope = allocator.emplace<Node::Scope>();
+    auto stmt = allocator.emplace<Node::StmtFor>();
+    stmt->ident = try_consume_err(TokenType::IDENTIFIER);
 
-    while (auto stmt = parse_scope_stmt()) {
-        scope->stmts.push_back(stmt.value());
+    try_consume_err(TokenType::IN);
 
-        if (stmt.value()->type.has_value())
-            scope->type = stmt.value()->type.value();
-    }
+    stmt->range = parse_range();
 
-    try_consume_err(TokenType::RIGHT_CURLY_BRACKET);
+    // STEP ?
+    if (peek_type(TokenType::IDENTIFIER) && peek().value().val.value() == "step") {
+        consume();
 
-    return scope;
-}
+        if (const auto step = parse_expr())
+            stmt->step = step.value();
+        else
+            exit_with("step");
 
-std::optional<Node::ScopeStmt*> Parser::parse_scope_stmt() {
-    if (!peek().has_value())
-        return {};
+        coerce_literal(stmt->step.value(), stmt->range->type);
 
+        if (!stmt->step.value()->type.is_integer())
+            exit_with("an integer", "step must be");
 
-    // ? ++
-    if (peek_type(TokenType::INCREMENTATOR, 1)) {
-        auto incr = allocator.alloc<Node::VarIncr>();
+        stmt->range->type = promote(stmt->range->type, stmt->step.value()->type);
 
-        if (const auto id = parse_identifier()) {
-            incr->ident = id.value();
+        // the loop counts up to the end, a literal step that does not move forward never ends
+        if (const auto term = std::get_if<Node::Term*>(&stmt->step.value()->var)) {
+            if (const auto lit = std::get_if<Node::TermIntegerLiteral*>(&(*term)->var)) {
+                if (std::stoull((*lit)->int_lit.val.value()) == 0)
+                    exit_with("positive", "step must be");
+            }
         }
-        else exit_with("int expression");
+    }
 
-        if (incr->ident->type != VarType::INT)
-            exit_with("int", "type expression must be");
+    // the induction variable is only visible in the body, which cannot modify it
+    begin_scope();
+    declare(stmt->ident, stmt->range->type);
+    immutables[stmt->ident.val.value()] = "loop variable '" + stmt->ident.val.value() + "'";
 
-        consume(); // ++
+    if (const auto scope = parse_scope())
+        stmt->scope = scope.value();
+    else
+        exit_with("scope");
 
-        auto s = allocator.emplace<Node::ScopeStmt>(incr);
-        s->type = VarType::INT;
-        return s;
-    }
+    end_scope();
 
-    // ? --
-    if (peek_type(TokenType::DECREMENTATOR, 1)) {
-        auto decr = allocator.alloc<Node::VarDecr>();
+    return stmt;
+}
 
-        if (const auto id = parse_identifier()) {
-            decr->ident = id.value();
-        }
-        else exit_with("int expression");
+std::optional<Node::StmtParallelFor*> Parser::parse_parallel_for() {
+    if (!try_consume(TokenType::PARALLEL))
+        return {};
 
-        if (decr->ident->type != VarType::INT)
-            exit_with("int", "type expression must be");
+    if (parallel.has_value())
+        exit_with("parallel for", "cannot nest");
 
-        consume(); // --
+    try_consume_err(TokenType::FOR);
 
-        auto s = allocator.emplace<Node::ScopeStmt>(decr);
-        s->type = VarType::INT;
-        return s;
-    }
+    auto stmt = allocator.emplace<Node::StmtParallelFor>();
+    stmt->ident = try_consume_err(TokenType::IDENTIFIER);
 
-    // RETURN ?
-    if (peek_type(TokenType::RETURN)) {
+    try_consume_err(TokenType::IN);
+
+    stmt->range = parse_range();
+
+    // GRAIN ?
+    if (peek_type(TokenType::IDENTIFIER) && peek().value().val.value() == "grain") {
         consume();
-        Node::StmtReturn* ret = allocator.emplace<Node::StmtReturn>();
 
-        if (auto ne = parse_expr())
-            ret->expr = ne.value();
+        if (const auto grain = parse_expr())
+            stmt->grain = grain.value();
         else
-            exit_with("return value");
-
-        Node::ScopeStmt* stmt = allocator.emplace<Node::ScopeStmt>(ret);
-        stmt->type = ret->expr->type;
+            exit_with("grain size");
 
-        return stmt;
+        if (!stmt->grain.value()->type.is_integer())
+            exit_with("an integer", "grain size must be");
     }
 
-    // VAR IDENT = ?
-    if (peek_type(TokenType::VAR) && peek_type(TokenType::IDENTIFIER, 1)) {
-        if (peek_type(TokenType::EQUAL, 2)) {
-            consume(); // var
+    // the induction variable is only visible in the body, which cannot modify it
+    begin_scope();
+    declare(stmt->ident, stmt->range->type);
+    immutables[stmt->ident.val.value()] = "loop variable '" + stmt->ident.val.value() + "'";
 
-            Node::StmtImplicitVar* var = allocator.emplace<Node::StmtImplicitVar>();
-            var->identifier = consume();
+    parallel = ParallelLoop{ .var = stmt->ident.val.value(), .depth = scopes.size() };
 
-            if (is_var(var->identifier.val.value()))
-                exit_with("'" + var->identifier.val.value() + "' already used", "identifier");
+    // the iterations run on other threads, each with its own arena: a frame around the loop is not theirs
+    const size_t outer_frames = std::exchange(frame_depth, 0);
 
-            consume(); // =
+    if (const auto scope = parse_scope())
+        stmt->scope = scope.value();
+    else
+        exit_with("scope");
 
-            if (auto e = parse_expr()) {
-                var->expr = e.value();
-            }
-            else {
-                exit_with("expression");
-            }
+    frame_depth = outer_frames;
 
-            identifiers[var->identifier.val.value()] = var->expr->type;
+    // an element written by an iteration cannot be read by another one
+    for (const auto& [ident, by_var] : parallel->indexed) {
+        if (!by_var && parallel->written.count(ident))
+            exit_with("'" + ident + "' as a whole or at another index than `" + parallel->var + "` while writing to it", "parallel for reads");
+    }
 
-            Node::ScopeStmt* stmt = allocator.emplace<Node::ScopeStmt>(var);
-            return stmt;
-        }
-        else if (peek_type(TokenType::COLON, 2) && peek_type(TokenType::EQUAL, 4)) {
-            consume(); // var
+    parallel.reset();
+    end_scope();
 
-            Node::StmtImplicitVar* var = allocator.emplace<Node::StmtImplicitVar>();
-            var->identifier = consume();
+    return stmt;
+}
 
-            if (is_var(var->identifier.val.value()))
-                exit_with("'" + var->identifier.val.value() + "' already used", "identifier");
+std::optional<Node::StmtFrame*> Parser::parse_frame() {
+    if (!try_consume(TokenType::FRAME))
+        return {};
 
-            consume(); // :
-            Token type = consume();
-            consume(); // =
+    auto stmt = allocator.emplace<Node::StmtFrame>();
 
-            if (auto e = parse_expr()) {
-                var->expr = e.value();
-            }
-            else {
-                exit_with("expression");
-            }
+    frame_depth++;
 
-            if (var->expr->type != to_variable_type(type.type))
-                exit_with(to_string(type.type), "variable type must be");
+    if (const auto scope = parse_scope())
+        stmt->scope = scope.value();
+    else
+        exit_with("scope");
 
-            identifiers[var->identifier.val.value()] = var->expr->type;
+    frame_depth--;
 
-            Node::ScopeStmt* stmt = allocator.emplace<Node::ScopeStmt>(var);
-            return stmt;
-        }
-        else if (peek_type(TokenType::COLON, 2)) {
-            consume(); // var
-            Node::StmtExplicitVar* var = allocator.emplace<Node::StmtExplicitVar>();
-            var->ident = consume();
+    return stmt;
+}
 
-            if (is_var(var->ident.val.value()))
-                exit_with("'" + var->ident.val.value() + "' already used", "identifier");
+std::optional<Node::StmtBench*> Parser::parse_bench() {
+    if (!try_consume(TokenType::BENCH))
+        return {};
 
-            consume(); // :
+    // the runs of the iterations would be timed together, and printed in any order
+    if (parallel.has_value())
+        exit_with("bench", "parallel for cannot contain");
 
-            if (auto t = parse_type()) {
-                var->type = t.value();
-            }
-            else {
-                exit_with("type");
-            }
+    auto stmt = allocator.emplace<Node::StmtBench>();
 
-            identifiers[var->ident.val.value()] = var->type;
+    try_consume_err(TokenType::LEFT_PARENTHESIS);
 
-            Node::ScopeStmt* stmt = allocator.emplace<Node::ScopeStmt>(var);
-            return stmt;
-        }
-        else
-            exit_with("type declaration");
-    }
+    if (const auto name = parse_expr())
+        stmt->name = name.value();
+    else
+        exit_with("bench name");
 
-    // IDENT = ?
-    if (peek_type(TokenType::IDENTIFIER) && peek_type(TokenType::EQUAL, 1)) {
-        auto var_assign = allocator.alloc<Node::StmtVarAssign>();
-        var_assign->ident = consume();
+    if (stmt->name->type != VarType::STRING)
+        exit_with("a string", "bench name must be");
 
-        if (!is_var(var_assign->ident.val.value())) {
-            exit_with("'" + var_assign->ident.val.value() + "'", "unknown identifier");
-        }
+    // , RUNS
+    if (try_consume(TokenType::COMMA)) {
+        if (const auto runs = parse_expr())
+            stmt->runs = runs.value();
+        else
+            exit_with("number of runs");
 
-        consume(); // = token
+        if (!stmt->runs.value()->type.is_integer())
+            exit_with("an integer", "number of runs must be");
+    }
 
-        if (const auto expr = parse_expr()) {
-            var_assign->expr = expr.value();
-        }
-        else
-            exit_with("expression");
+    try_consume_err(TokenType::RIGHT_PARENTHESIS);
 
-        if (identifiers[var_assign->ident.val.value()] != var_assign->expr->type) {
-            exit_with(to_string(var_assign->expr->type), "wrong type ");
-        }
+    bench_depth++;
 
-        return allocator.emplace<Node::ScopeStmt>(var_assign);
-    }
+    if (const auto scope = parse_scope())
+        stmt->scope = scope.value();
+    else
+        exit_with("scope");
+
+    bench_depth--;
 
-    // IDENT( ? )
-    if (peek_type(TokenType::IDENTIFIER) && peek_type(TokenType::LEFT_PARENTHESIS, 1)) {
-        auto fcall = allocator.alloc<Node::FuncCall>();
-        fcall->ident = consume();
+    return stmt;
+}
 
-        if (is_buildin_func(fcall->ident.val.value())) {
-            fcall->type = buildin_func_type.at(fcall->ident.val.value());
-        }
-        else if (const auto t = var_type(fcall->ident.val.value())) {
-            fcall->type = t.value();
-        }
-        else
-            exit_with(fcall->ident.val.value(), "unknown identifier ");
+std::optional<Node::StmtMatch*> Parser::parse_match() {
+    if (!try_consume(TokenType::MATCH))
+        return {};
 
-        consume(); // ( token
+    auto stmt = allocator.emplace<Node::StmtMatch>();
 
-        fcall->args = parse_args();
+    try_consume_err(TokenType::LEFT_PARENTHESIS);
 
-        try_consume_err(TokenType::RIGHT_PARENTHESIS);
+    if (const auto expr = parse_expr())
+        stmt->expr = expr.value();
+    else
+        exit_with("expression");
 
-        return allocator.emplace<Node::ScopeStmt>(fcall);
-    }
+    try_consume_err(TokenType::RIGHT_PARENTHESIS);
 
-    // { ? }
-    if (peek_type(TokenType::LEFT_CURLY_BACKET)) {
-        if (auto scope = parse_scope()) {
-            auto stmt = allocator.emplace<Node::ScopeStmt>(scope.value());
-            return stmt;
-        }
-        else
-            exit_with("scope");
-    }
+    const VarType& t = stmt->expr->type;
+    if (!t.is_integer() && t.kind != VarType::CHAR && t.kind != VarType::ENUM)
+        exit_with("an integer, a char or an enum, not " + to_string(t), "match value must be");
 
-    // WHILE ( ? ) { ? }
-    if (const auto twhile = try_consume(TokenType::WHILE)) {
-        try_consume_err(TokenType::LEFT_PARENTHESIS);
+    try_consume_err(TokenType::LEFT_CURLY_BACKET);
 
-        auto stmt_while = allocator.alloc<Node::StmtWhile>();
+    while (!peek_type(TokenType::RIGHT_CURLY_BRACKET)) {
+        if (stmt->has_else)
+            exit_with("arm of a match", "`else` must be the last");
 
-        if (const auto expr = parse_expr()) {
-            stmt_while->expr = expr.value();
+        auto arm = allocator.emplace<Node::MatchArm>();
+
+        // ELSE => { ? }
+        if (try_consume(TokenType::ELSE)) {
+            stmt->has_else = true;
+        }
+        // CASE (, CASE)* => { ? }
+        else {
+            do {
+                Node::MatchCase c;
+                c.first = parse_match_value(t);
+                c.last = c.first;
+
+                if (try_consume(TokenType::RANGE_INCLUSIVE)) {
+                    c.last = parse_match_value(t);
+                }
+                else if (try_consume(TokenType::RANGE)) {
+                    c.last = parse_match_value(t) - 1;
+                }
+
+                if (c.last < c.first)
+                    exit_with("empty", "match range is");
+
+                arm->cases.push_back(c);
+            } while (try_consume(TokenType::COMMA));
         }
-        else
-            exit_with("expression");
 
-        try_consume_err(TokenType::RIGHT_PARENTHESIS);
+        try_consume_err(TokenType::ARROW);
 
-        if (const auto scope = parse_scope()) {
-            stmt_while->scope = scope.value();
-        }
+        if (const auto scope = parse_scope())
+            arm->scope = scope.value();
         else
             exit_with("scope");
 
-        return allocator.emplace<Node::ScopeStmt>(stmt_while);
+        stmt->arms.push_back(arm);
     }
 
-    // IF ( ? ) { ? } ?
-    if (const auto tif = try_consume(TokenType::IF)) {
-        try_consume_err(TokenType::LEFT_PARENTHESIS);
+    check_match_cases(stmt);
 
-        auto stmt_if = allocator.alloc<Node::StmtIf>();
+    try_consume_err(TokenType::RIGHT_CURLY_BRACKET);
 
-        if (const auto expr = parse_expr()) {
-            stmt_if->expr = expr.value();
-        }
-        else
-            exit_with("expression");
+    return stmt;
+}
 
-        try_consume_err(TokenType::RIGHT_PARENTHESIS);
+// cases are kept as __int128, wide enough for every i64 and u64 value
+static std::string case_string(__int128 v) {
+    if (v < 0)
+        return std::to_string(static_cast<long long>(v));
+    return std::to_string(static_cast<unsigned long long>(v));
+}
 
-        if (const auto scope = parse_scope()) {
-            stmt_if->scope = scope.value();
+__int128 Parser::parse_match_value(const VarType& t) {
+    // Value or Enum.Value
+    if (t.kind == VarType::ENUM) {
+        if (peek_type(TokenType::IDENTIFIER) && peek().value().val.value() == t.name && peek_type(TokenType::DOT, 1)) {
+            consume();
+            consume();
         }
-        else
-            exit_with("scope");
+        return enum_index(t, try_consume_err(TokenType::IDENTIFIER));
+    }
 
-        stmt_if->pred = parse_if_pred();
+    // a constant is replaced by its value
+    if (peek_type(TokenType::IDENTIFIER)) {
+        const Token ident = consume();
+        const auto value = int_constant(ident);
+        if (!value.has_value() || (identifiers.at(ident.val.value()).kind == VarType::CHAR) != (t.kind == VarType::CHAR))
+            exit_with("'" + ident.val.value() + "' is not a constant of type " + to_string(t), "match value");
 
-        auto stmt = allocator.emplace<Node::ScopeStmt>(stmt_if);
-        return stmt;
+        if (t.kind == VarType::CHAR)
+            return value.value();
+
+        if (value.value() < t.min() || value.value() > static_cast<__int128>(t.max()))
+            exit_with(ident.val.value() + " = " + case_string(value.value()) + " out of range for " + to_string(t), "constant");
+        return value.value();
     }
 
-    return {};
+    if (t.kind == VarType::CHAR)
+        return static_cast<signed char>(try_consume_err(TokenType::CHAR_LITERAL).val.value()[0]);
+
+    const bool negative = try_consume(TokenType::MINUS).has_value();
+
+    const std::string literal = try_consume_err(TokenType::INTEGER_LITERAL).val.value();
+    const __int128 value = negative ? -static_cast<__int128>(std::stoull(literal)) : static_cast<__int128>(std::stoull(literal));
+    if (value < t.min() || value > static_cast<__int128>(t.max()))
+        exit_with((negative ? "-" : "") + literal + " out of range for " + to_string(t), "integer literal");
+
+    return value;
 }
 
-std::vector<Node::Expr*> Parser::parse_args() {
-    std::vector<Node::Expr*> args{};
+void Parser::check_match_cases(const Node::StmtMatch* stmt) {
+    const VarType& t = stmt->expr->type;
 
-    if (const auto e = parse_expr()) {
-        args.push_back(e.value());
+    // `char` is signed in the generated c++, the values of an enum are numbered from 0
+    __int128 min = 0;
+    __int128 max = 0;
+    if (t.kind == VarType::CHAR) {
+        min = -128;
+        max = 127;
+    }
+    else if (t.kind == VarType::ENUM) {
+        max = enums.at(t.name)->values.size() - 1;
+    }
+    else {
+        min = t.min();
+        max = t.max();
+    }
 
-        while (const auto comma = try_consume(TokenType::COMMA)) {
-            if (const auto e = parse_expr()) {
-                args.push_back(e.value());
-            }
-            else
-                exit_with("expression");
-        }
+    const auto show = [&](__int128 v) {
+        if (t.kind == VarType::ENUM)
+            return t.name + "." + enums.at(t.name)->values[static_cast<size_t>(v)].val.value();
+        if (t.kind == VarType::CHAR && v >= 0 && std::isalnum(static_cast<int>(v)))
+            return "'" + std::string(1, static_cast<char>(v)) + "'";
+        return case_string(v);
+    };
+
+    std::vector<Node::MatchCase> cases;
+    for (const Node::MatchArm* arm : stmt->arms)
+        cases.insert(cases.end(), arm->cases.begin(), arm->cases.end());
+
+    std::sort(cases.begin(), cases.end(), [](const Node::MatchCase& a, const Node::MatchCase& b) {
+        return a.first < b.first;
+    });
+
+    for (size_t i = 1; i < cases.size(); i++) {
+        if (cases[i].first <= cases[i - 1].last)
+            exit_with(show(cases[i].first) + " has two arms", "match value");
     }
 
-    return args;
+    if (stmt->has_else)
+        return;
+
+    // first value not covered by the cases seen so far
+    __int128 next = min;
+    for (const Node::MatchCase& c : cases) {
+        if (c.first > next)
+            break;
+        if (c.last == max)
+            return;
+        next = c.last + 1;
+    }
+
+    exit_with("missing " + show(next) + " (add `else =>`)", "match is not exhaustive,");
 }
 
 std::optional<Node::IfPred*> Parser::parse_if_pred() {
     if (auto t = try_consume(TokenType::ELIF)) {
         try_consume_err(TokenType::LEFT_PARENTHESIS);
-        auto elif_pred = allocator.alloc<Node::IfPredElif>();
+        auto elif_pred = allocator.emplace<Node::IfPredElif>();
         if (const auto expr = parse_expr())
             elif_pred->expr = expr.value();
         else
@@ -601,7 +2258,7 @@ std::optional<Node::IfPred*> Parser::parse_if_pred() {
     }
 
     if (try_consume(TokenType::ELSE)) {
-        auto else_pred = allocator.alloc<Node::IfPredElse>();
+        auto else_pred = allocator.emplace<Node::IfPredElse>();
         if (const auto scope = parse_scope())
             else_pred->scope = scope.value();
         else
@@ -613,14 +2270,12 @@ std::optional<Node::IfPred*> Parser::parse_if_pred() {
     return {};
 }
 
-std::optional<Node::Expr*> Parser::parse_expr(int min_prec) {
+std::optional<Node::Expr*> Parser::parse_unary() {
     // ! ?
-    if (peek_type(TokenType::NOT)) {
-        consume();
-
-        auto nexpr = allocator.alloc<Node::ExprNot>();
+    if (try_consume(TokenType::NOT)) {
+        auto nexpr = allocator.emplace<Node::ExprNot>();
 
-        if (const auto e = parse_expr()) {
+        if (const auto e = parse_unary()) {
             if (e.value()->type != VarType::BOOL)
                 exit_with(to_string(VarType::BOOL), "expression must be of type");
             nexpr->expr = e.value();
@@ -632,50 +2287,77 @@ std::optional<Node::Expr*> Parser::parse_expr(int min_prec) {
         return expr;
     }
 
+    // ~ ?
+    if (try_consume(TokenType::BIT_NOT)) {
+        auto nexpr = allocator.emplace<Node::ExprBitNot>();
+
+        if (const auto e = parse_unary()) {
+            if (!e.value()->type.is_integer())
+                exit_with("integer", "type expression must be");
+            nexpr->expr = e.value();
+        }
+        else exit_with("integer expression");
+
+        auto expr = allocator.emplace<Node::Expr>(nexpr);
+        expr->type = nexpr->expr->type;
+        return expr;
+    }
+
+    if (const auto term = parse_term()) {
+        auto expr = allocator.emplace<Node::Expr>(term.value());
+        expr->type = term.value()->type;
+        return expr;
+    }
+
+    return {};
+}
+
+std::optional<Node::Expr*> Parser::parse_expr(int min_prec) {
     // ? ++
     if (peek_type(TokenType::INCREMENTATOR, 1)) {
-        auto incr = allocator.alloc<Node::VarIncr>();
+        auto incr = allocator.emplace<Node::VarIncr>();
 
         if (const auto id = parse_identifier()) {
             incr->ident = id.value();
         }
         else exit_with("int expression");
 
-        if (incr->ident->type != VarType::INT)
-            exit_with("int", "type expression must be");
+        if (!incr->ident->type.is_integer())
+            exit_with("integer", "type expression must be");
+        check_mutable(incr->ident->ident);
 
         consume(); // ++
 
         auto expr = allocator.emplace<Node::Expr>(incr);
-        expr->type = VarType::INT;
+        expr->type = incr->ident->type;
         return expr;
     }
 
     // ? --
     if (peek_type(TokenType::DECREMENTATOR, 1)) {
-        auto decr = allocator.alloc<Node::VarDecr>();
+        auto decr = allocator.emplace<Node::VarDecr>();
 
         if (const auto id = parse_identifier()) {
             decr->ident = id.value();
         }
         else exit_with("int expression");
 
-        if (decr->ident->type != VarType::INT)
-            exit_with("int", "type expression must be");
+        if (!decr->ident->type.is_integer())
+            exit_with("integer", "type expression must be");
+        check_mutable(decr->ident->ident);
 
         consume(); // --
 
         auto expr = allocator.emplace<Node::Expr>(decr);
-        expr->type = VarType::INT;
+        expr->type = decr->ident->type;
         return expr;
     }
 
-    std::optional<Node::Term*> lterm = parse_term();
-    if (!lterm.has_value())
+    const std::optional<Node::Expr*> lside = parse_unary();
+    if (!lside.has_value())
         return {};
 
-    auto expr = allocator.emplace<Node::Expr>(lterm.value());
-    expr->type = lterm.value()->type;
+    auto expr = lside.value();
 
     /// TODO:
     /// check compatibility between left and right expressions
@@ -701,17 +2383,25 @@ std::optional<Node::Expr*> Parser::parse_expr(int min_prec) {
             exit_with("expression");
         }
 
-        auto return_type = get_return_type(expr->type, op.type, expr_rside.value()->type);
+        // a literal operand takes the type of the other one when it fits (x + 1 is a u8 when x is a u8)
+        // but the shifted value keeps its own type (1 << n stays an int when n is a u8)
+        const bool shift = op.type == TokenType::SHIFT_LEFT || op.type == TokenType::SHIFT_RIGHT;
+        coerce_literal(expr_rside.value(), expr->type, false);
+        if (!shift)
+            coerce_literal(expr, expr_rside.value()->type, false);
+
+        auto op_type = get_return_type(expr->type, op.type, expr_rside.value()->type);
 
-        if (!return_type.has_value())
+        if (!op_type.has_value())
             exit_with(
                 to_string(expr->type) + " " + to_string(op.type) + " " + to_string(expr_rside.value()->type),
                 "wrong operation :");
 
-        expr->type = return_type.value();
-
         auto bin_expr = allocator.emplace<Node::BinExpr>();
-        auto expr_lside = allocator.emplace<Node::Expr>(expr->var);
+        bin_expr->op = op.type;
+        auto expr_lside = allocator.emplace<Node::Expr>(expr->var, expr->type);
+
+        expr->type = op_type.value();
 
         if (op.type == TokenType::PLUS) {
             auto add = allocator.emplace<Node::BinExprAdd>(expr_lside, expr_rside.value());
@@ -731,6 +2421,30 @@ std::optional<Node::Expr*> Parser::parse_expr(int min_prec) {
             auto div = allocator.emplace<Node::BinExprDiv>(expr_lside, expr_rside.value());
             bin_expr->var = div;
         }
+        else if (op.type == TokenType::PERCENT) {
+            auto mod = allocator.emplace<Node::BinExprMod>(expr_lside, expr_rside.value());
+            bin_expr->var = mod;
+        }
+        else if (op.type == TokenType::BIT_AND) {
+            auto bit_and = allocator.emplace<Node::BinExprBitAnd>(expr_lside, expr_rside.value());
+            bin_expr->var = bit_and;
+        }
+        else if (op.type == TokenType::BIT_OR) {
+            auto bit_or = allocator.emplace<Node::BinExprBitOr>(expr_lside, expr_rside.value());
+            bin_expr->var = bit_or;
+        }
+        else if (op.type == TokenType::BIT_XOR) {
+            auto bit_xor = allocator.emplace<Node::BinExprBitXor>(expr_lside, expr_rside.value());
+            bin_expr->var = bit_xor;
+        }
+        else if (op.type == TokenType::SHIFT_LEFT) {
+            auto shl = allocator.emplace<Node::BinExprShl>(expr_lside, expr_rside.value());
+            bin_expr->var = shl;
+        }
+        else if (op.type == TokenType::SHIFT_RIGHT) {
+            auto shr = allocator.emplace<Node::BinExprShr>(expr_lside, expr_rside.value());
+            bin_expr->var = shr;
+        }
         else if (op.type == TokenType::IS_EQUAL) {
             auto iseq = allocator.emplace<Node::BinExprIsEqual>(expr_lside, expr_rside.value());
             bin_expr->var = iseq;
@@ -772,30 +2486,43 @@ std::optional<Node::Expr*> Parser::parse_expr(int min_prec) {
     return expr;
 }
 
-std::optional<Node::Term*> Parser::parse_term() {
-    // FUNC CALL
-    if (peek_type(TokenType::IDENTIFIER) && peek_type(TokenType::LEFT_PARENTHESIS, 1)) {
-        auto fcall = allocator.alloc<Node::FuncCall>();
-        fcall->ident = consume();
+void Parser::consume_closing_angle() {
+    // list<list<int>>: the first list takes one half of the `>>`, the outer one the other
+    if (peek_type(TokenType::SHIFT_RIGHT)) {
+        tokens[index].type = TokenType::GREATER;
+        return;
+    }
 
-        if (is_buildin_func(fcall->ident.val.value())) {
-            fcall->type = buildin_func_type.at(fcall->ident.val.value());
-        }
-        else if (const auto t = var_type(fcall->ident.val.value())) {
-            fcall->type = t.value();
-        }
-        else
-            exit_with(fcall->ident.val.value(), "unknown identifier");
+    try_consume_err(TokenType::GREATER);
+}
+
+std::optional<Node::Term*> Parser::parse_term() {
+    // CONVERSIONS, VECTOR AND STRUCT CONSTRUCTORS
+    if (const auto construct = parse_construct()) {
+        auto term = allocator.emplace<Node::Term>(construct.value());
+        term->type = construct.value()->type;
+        return parse_postfix(term);
+    }
 
-        consume(); // ( token
+    // FUNC CALL
+    if (const auto fcall = parse_func_call()) {
+        auto term = allocator.emplace<Node::Term>(fcall.value());
+        term->type = fcall.value()->type;
 
-        fcall->args = parse_args();
+        return parse_postfix(term);
+    }
 
-        try_consume_err(TokenType::RIGHT_PARENTHESIS);
+    // ENUM.VALUE
+    if (peek_type(TokenType::IDENTIFIER) && enums.count(peek().value().val.value())) {
+        const Token ident = consume();
+        const VarType t = VarType::enum_of(ident.val.value());
 
-        auto term = allocator.emplace<Node::Term>(fcall);
-        term->type = fcall->type;
+        try_consume_err(TokenType::DOT);
 
+        const Token value = try_consume_err(TokenType::IDENTIFIER);
+        auto term_enum_value = allocator.emplace<Node::TermEnumValue>(ident, value, enum_index(t, value));
+        auto term = allocator.emplace<Node::Term>(term_enum_value);
+        term->type = t;
         return term;
     }
 
@@ -803,7 +2530,15 @@ std::optional<Node::Term*> Parser::parse_term() {
     if (const auto ident = parse_identifier()) {
         auto term = allocator.emplace<Node::Term>(ident.value());
         term->type = ident.value()->type;
-        return term;
+
+        // an outer variable used whole (given to a function, copied) may be read at any index
+        if (parallel.has_value() && !peek_type(TokenType::LEFT_SQUARE_BRACKET)) {
+            const std::string& name = ident.value()->ident.val.value();
+            if (!declared_since(name, parallel->depth))
+                parallel->indexed.emplace_back(name, false);
+        }
+
+        return parse_postfix(term);
     }
 
     // LITERALS
@@ -817,7 +2552,37 @@ std::optional<Node::Term*> Parser::parse_term() {
     if (auto int_lit = try_consume(TokenType::INTEGER_LITERAL)) {
         auto term_int_lit = allocator.emplace<Node::TermIntegerLiteral>(int_lit.value());
         auto term = allocator.emplace<Node::Term>(term_int_lit);
-        term->type = VarType::INT;
+
+        // an int unless the value is too big for one
+        unsigned long long value = 0;
+        try {
+            value = std::stoull(int_lit.value().val.value());
+        }
+        catch (const std::out_of_range&) {
+            exit_with(int_lit.value().val.value() + " out of range for u64", "integer literal");
+        }
+
+        if (value <= VarType(VarType::INT).max())
+            term->type = VarType::INT;
+        else if (value <= VarType(VarType::I64).max())
+            term->type = VarType::I64;
+        else
+            term->type = VarType::U64;
+
+        return term;
+    }
+
+    if (auto float_lit = try_consume(TokenType::FLOAT_LITERAL)) {
+        auto term_float_lit = allocator.emplace<Node::TermFloatLiteral>(float_lit.value());
+        auto term = allocator.emplace<Node::Term>(term_float_lit);
+        term->type = VarType::FLOAT;
+        return term;
+    }
+
+    if (auto double_lit = try_consume(TokenType::DOUBLE_LITERAL)) {
+        auto term_double_lit = allocator.emplace<Node::TermFloatLiteral>(double_lit.value());
+        auto term = allocator.emplace<Node::Term>(term_double_lit);
+        term->type = VarType::DOUBLE;
         return term;
     }
 
@@ -846,7 +2611,7 @@ std::optional<Node::Term*> Parser::parse_term() {
         auto term_paren = allocator.emplace<Node::TermParen>(expr.value());
         auto term = allocator.emplace<Node::Term>(term_paren);
         term->type = expr.value()->type;
-        return term;
+        return parse_postfix(term);
     }
 
     return {};
@@ -868,18 +2633,340 @@ std::optional<Node::TermIdentifier*> Parser::parse_identifier() {
     return {};
 }
 
-std::optional<VarType> Parser::parse_type() {
+std::optional<Node::TermConstruct*> Parser::parse_construct() {
+    if (!peek_type(TokenType::LEFT_PARENTHESIS, 1))
+        return {};
+
+    // STRUCT( ? ), one value per field
+    if (peek_type(TokenType::IDENTIFIER) && structs.count(peek().value().val.value())) {
+        const Node::StructDeclaration* st = structs.at(consume().val.value());
+        auto construct = allocator.emplace<Node::TermConstruct>(VarType::struct_of(st->ident.val.value()));
+
+        consume(); // (
+
+        construct->args = parse_args();
+
+        try_consume_err(TokenType::RIGHT_PARENTHESIS);
+
+        if (construct->args.size() != st->fields.size())
+            exit_with(std::to_string(st->fields.size()) + " value(s)", st->ident.val.value() + " takes");
+
+        for (size_t i = 0; i < st->fields.size(); i++) {
+            coerce_literal(construct->args[i], st->fields[i]->type);
+
+            if (construct->args[i]->type != st->fields[i]->type)
+                exit_with(to_string(st->fields[i]->type), "field `" + st->fields[i]->ident.val.value() + "` must be of type");
+        }
+
+        return construct;
+    }
+
+    // STRING( ? ), a copy of the characters of a view
+    if (peek_type(TokenType::TYPE_STRING)) {
+        auto construct = allocator.emplace<Node::TermConstruct>(to_variable_type(consume().type));
+
+        consume(); // (
+
+        construct->args = parse_args();
+
+        try_consume_err(TokenType::RIGHT_PARENTHESIS);
+
+        if (construct->args.size() != 1 || (construct->args[0]->type.kind != VarType::STR_VIEW && construct->args[0]->type.kind != VarType::STRING))
+            exit_with("a string or a str_view", "string takes");
+
+        return construct;
+    }
+
+    switch (peek().value().type) {
+    case TokenType::TYPE_INT:
+    case TokenType::TYPE_I8:
+    case TokenType::TYPE_I16:
+    case TokenType::TYPE_I64:
+    case TokenType::TYPE_U8:
+    case TokenType::TYPE_U16:
+    case TokenType::TYPE_U32:
+    case TokenType::TYPE_U64:
+    case TokenType::TYPE_FLOAT:
+    case TokenType::TYPE_DOUBLE:
+    case TokenType::TYPE_VEC2:
+    case TokenType::TYPE_VEC3:
+    case TokenType::TYPE_VEC4:
+        break;
+    default:
+        return {};
+    }
+
+    auto construct = allocator.emplace<Node::TermConstruct>(to_variable_type(consume().type));
+
+    consume(); // (
+
+    construct->args = parse_args();
+
+    try_consume_err(TokenType::RIGHT_PARENTHESIS);
+
+    for (const Node::Expr* arg : construct->args) {
+        // the position of an enum value converts to an integer
+        if (arg->type.kind == VarType::ENUM && construct->type.is_integer())
+            continue;
+
+        if (!arg->type.is_numeric())
+            exit_with(to_string(arg->type) + " to " + to_string(construct->type), "cannot convert");
+    }
+
+    // a vector is built from one value per component, or from a single value copied in every component
+    const size_t lanes = construct->type.lanes();
+    if (construct->args.size() != 1 && construct->args.size() != lanes)
+        exit_with(std::to_string(lanes) + " value(s)", to_string(construct->type) + " takes");
+
+    return construct;
+}
+
+Node::Term* Parser::parse_postfix(Node::Term* term) {
+    while (true) {
+        // TERM.FIELD
+        if (try_consume(TokenType::DOT)) {
+            const Token name = try_consume_err(TokenType::IDENTIFIER);
+
+            VarType type;
+
+            if (term->type.kind == VarType::STRUCT) {
+                type = field(term->type, name.val.value())->type;
+            }
+            else if (term->type.is_vector()) {
+                const size_t lane = std::string("xyzw").find(name.val.value());
+                if (name.val.value().size() != 1 || lane >= term->type.lanes())
+                    exit_with(to_string(term->type) + " field `" + name.val.value() + "`", "unknown");
+                type = VarType::FLOAT;
+            }
+            else
+                exit_with(to_string(term->type), "cannot access a field of a value of type");
+
+            auto term_field = allocator.emplace<Node::TermField>(term, name);
+            term = allocator.emplace<Node::Term>(term_field);
+            term->type = type;
+            continue;
+        }
+
+        // TERM[ ? ]
+        const auto bracket = try_consume(TokenType::LEFT_SQUARE_BRACKET);
+        if (!bracket.has_value())
+            break;
+
+        const bool text = term->type.kind == VarType::STRING || term->type.kind == VarType::STR_VIEW;
+        if (!term->type.is_container() && term->type.kind != VarType::BYTES && !text)
+            exit_with(to_string(term->type), "cannot index a value of type");
+
+        auto index = allocator.emplace<Node::TermIndex>(term);
+        index->line = bracket.value().line;
+
+        if (const auto e = parse_expr())
+            index->index = e.value();
+        else
+            exit_with("index");
+
+        if (!index->index->type.is_integer())
+            exit_with("an integer", "index must be");
+
+        // TEXT[ ?..? ], a view of the characters from begin to end (excluded)
+        if (text && try_consume(TokenType::RANGE)) {
+            auto slice = allocator.emplace<Node::TermSlice>(term, index->index);
+            slice->line = index->line;
+
+            if (const auto e = parse_expr())
+                slice->end = e.value();
+            else
+                exit_with("slice end");
+
+            if (!slice->end->type.is_integer())
+                exit_with("an integer", "slice end must be");
+
+            try_consume_err(TokenType::RIGHT_SQUARE_BRACKET);
+
+            term = allocator.emplace<Node::Term>(slice);
+            term->type = VarType::STR_VIEW;
+            continue;
+        }
+
+        try_consume_err(TokenType::RIGHT_SQUARE_BRACKET);
+
+        // the characters of a string or a view are read as chars
+        if (text) {
+            term = allocator.emplace<Node::Term>(index);
+            term->type = VarType::CHAR;
+            continue;
+        }
+
+        // remember how the outer containers are indexed, to check the parallel for writes
+        if (parallel.has_value()) {
+            if (const auto ident = std::get_if<Node::TermIdentifier*>(&term->var)) {
+                const std::string& name = (*ident)->ident.val.value();
+                if (!declared_since(name, parallel->depth))
+                    parallel->indexed.emplace_back(name, is_parallel_index(index->index));
+            }
+        }
+
+        // the fields of an element are stored in different arrays, there is no element to read as a whole
+        if (term->type.soa && !peek_type(TokenType::DOT))
+            exit_with("field by field", "elements of an @soa array can only be accessed");
+
+        // the elements of bytes are u8
+        const VarType elem = term->type.kind == VarType::BYTES ? VarType(VarType::U8) : *term->type.elem;
+        term = allocator.emplace<Node::Term>(index);
+        term->type = elem;
+    }
+
+    return term;
+}
+
+std::optional<VarType> Parser::parse_scalar_type() {
     if (auto t = try_consume(TokenType::TYPE_BOOL))
         return VarType::BOOL;
 
     if (auto t = try_consume(TokenType::TYPE_INT))
         return VarType::INT;
 
+    if (auto t = try_consume(TokenType::TYPE_I8))
+        return VarType::I8;
+
+    if (auto t = try_consume(TokenType::TYPE_I16))
+        return VarType::I16;
+
+    if (auto t = try_consume(TokenType::TYPE_I64))
+        return VarType::I64;
+
+    if (auto t = try_consume(TokenType::TYPE_U8))
+        return VarType::U8;
+
+    if (auto t = try_consume(TokenType::TYPE_U16))
+        return VarType::U16;
+
+    if (auto t = try_consume(TokenType::TYPE_U32))
+        return VarType::U32;
+
+    if (auto t = try_consume(TokenType::TYPE_U64))
+        return VarType::U64;
+
     if (auto t = try_consume(TokenType::TYPE_CHAR))
         return VarType::CHAR;
 
     if (auto t = try_consume(TokenType::TYPE_STRING))
         return VarType::STRING;
 
+    if (auto t = try_consume(TokenType::TYPE_BYTES))
+        return VarType::BYTES;
+
+    if (auto t = try_consume(TokenType::TYPE_STR_VIEW))
+        return VarType::STR_VIEW;
+
+    if (auto t = try_consume(TokenType::TYPE_FLOAT))
+        return VarType::FLOAT;
+
+    if (auto t = try_consume(TokenType::TYPE_DOUBLE))
+        return VarType::DOUBLE;
+
+    if (auto t = try_consume(TokenType::TYPE_VEC2))
+        return VarType::VEC2;
+
+    if (auto t = try_consume(TokenType::TYPE_VEC3))
+        return VarType::VEC3;
+
+    if (auto t = try_consume(TokenType::TYPE_VEC4))
+        return VarType::VEC4;
+
+    if (peek_type(TokenType::IDENTIFIER) && structs.count(peek().value().val.value()))
+        return VarType::struct_of(consume().val.value());
+
+    if (peek_type(TokenType::IDENTIFIER) && enums.count(peek().value().val.value()))
+        return VarType::enum_of(consume().val.value());
+
     return {};
 }
+
+std::optional<VarType> Parser::parse_type() {
+    std::optional<VarType> type;
+
+    // LIST < TYPE >
+    if (try_consume(TokenType::TYPE_LIST)) {
+        try_consume_err(TokenType::LOWER);
+
+        if (const auto elem = parse_type())
+            type = VarType::list_of(elem.value());
+        else
+            exit_with("type");
+
+        check_storable(*type.value().elem, "a list");
+
+        consume_closing_angle();
+    }
+    else if (try_consume(TokenType::TYPE_MAP)) {
+        try_consume_err(TokenType::LOWER);
+
+        const std::optional<VarType> key = parse_type();
+        if (!key.has_value())
+            exit_with("key type");
+
+        // keys are hashed and compared for equality
+        const VarType& k = key.value();
+        if (!k.is_integer() && k.kind != VarType::CHAR && k.kind != VarType::STRING && k.kind != VarType::BOOL && k.kind != VarType::ENUM)
+            exit_with("an integer, a char, a bool, a string or an enum", "map keys must be");
+
+        try_consume_err(TokenType::COMMA);
+
+        if (const auto value = parse_type())
+            type = VarType::map_of(k, value.value());
+        else
+            exit_with("value type");
+
+        check_storable(*type.value().elem, "a map");
+
+        consume_closing_angle();
+    }
+    else
+        type = parse_scalar_type();
+
+    if (!type.has_value())
+        return {};
+
+    // TYPE[N][M] is an array of N arrays of M elements
+    std::vector<size_t> sizes;
+    while (try_consume(TokenType::LEFT_SQUARE_BRACKET)) {
+        // a literal or an integer constant
+        unsigned long long n = 0;
+        if (const auto ident = try_consume(TokenType::IDENTIFIER)) {
+            const auto value = int_constant(ident.value());
+            if (!value.has_value() || !identifiers.at(ident.value().val.value()).is_integer())
+                exit_with("'" + ident.value().val.value() + "' is not an integer constant", "array size");
+            if (value.value() <= 0)
+                exit_with("array size must be positive", "invalid");
+            n = static_cast<unsigned long long>(value.value());
+        }
+        else
+            n = std::stoull(try_consume_err(TokenType::INTEGER_LITERAL).val.value());
+
+        if (n == 0)
+            exit_with("array size must be positive", "invalid");
+        sizes.push_back(n);
+
+        try_consume_err(TokenType::RIGHT_SQUARE_BRACKET);
+    }
+
+    if (!sizes.empty())
+        check_storable(type.value(), "an array");
+
+    for (auto it = sizes.rbegin(); it != sizes.rend(); it++)
+        type = VarType::array_of(type.value(), *it);
+
+    // TYPE[N] @soa
+    if (try_consume(TokenType::AT)) {
+        const Token annotation = try_consume_err(TokenType::IDENTIFIER);
+        if (annotation.val.value() != "soa")
+            exit_with("annotation @" + annotation.val.value(), "unknown");
+
+        if (type.value().kind != VarType::ARRAY || type.value().elem->kind != VarType::STRUCT)
+            exit_with("an array of structs", "@soa only applies to");
+
+        type.value().soa = true;
+    }
+
+    return type;
+}
@@ -1,21 +1,116 @@
 #pragma once
 
 #include <unordered_map>
+#include <unordered_set>
 #include <cassert>
 #include <variant>
+#include <memory>
 
 #include "tokenizer.h"
 #include "arena.hpp"
 
-enum VarType {
-    VOID,
-    BOOL,
-    INT,
-    CHAR,
-    STRING
+namespace module {
+    struct Interface;
+}
+
+struct VarType {
+    enum Kind {
+        VOID,
+        BOOL,
+        // int is 32 bits signed, also spelled i32
+        INT,
+        I8,
+        I16,
+        I64,
+        U8,
+        U16,
+        U32,
+        U64,
+        CHAR,
+        STRING,
+        FLOAT,
+        DOUBLE,
+        VEC2,
+        VEC3,
+        VEC4,
+        STRUCT,
+        ENUM,
+        ARRAY,
+        LIST,
+        MAP,
+        // read-only view of the bytes of a mapped file
+        BYTES,
+        // read-only view of the characters of a string, which must outlive it
+        STR_VIEW
+    };
+
+    Kind kind{ Kind::VOID };
+
+    // type of the elements of an array or a list, or of the values of a map
+    std::shared_ptr<VarType> elem{};
+
+    // type of the keys of a map
+    std::shared_ptr<VarType> key{};
+
+    // number of elements of an array
+    size_t size{ 0 };
+
+    // name of a struct or an enum
+    std::string name{};
+
+    // array of structs stored as one array per field (`Particle[1024] @soa`)
+    bool soa{ false };
+
+    VarType(Kind kind = Kind::VOID);
+
+    // fixed-size array of `size` elements of type `elem`
+    static VarType array_of(const VarType& elem, size_t size);
+
+    // growable list of elements of type `elem`
+    static VarType list_of(const VarType& elem);
+
+    // hash map from `key` to `value`
+    static VarType map_of(const VarType& key, const VarType& value);
+
+    // value of the struct `name`
+    static VarType struct_of(const std::string& name);
+
+    // value of the enum `name`
+    static VarType enum_of(const std::string& name);
+
+    // true for arrays and lists
+    bool is_container() const;
+
+    // true for int and the fixed-width integers
+    bool is_integer() const;
+
+    // true for integers, float and double
+    bool is_numeric() const;
+
+    // true for the types passed by value: bool, char, numbers, vectors and enums
+    bool is_scalar() const;
+
+    // true for u8, u16, u32 and u64
+    bool is_unsigned() const;
+
+    // size in bits of an integer
+    int bits() const;
+
+    // smallest and largest values of an integer type
+    long long min() const;
+    unsigned long long max() const;
+
+    // true for vec2, vec3 and vec4
+    bool is_vector() const;
+
+    // number of components of a vector (2 for vec2, ...)
+    size_t lanes() const;
+
+    bool operator==(const VarType& other) const;
 };
 
-std::string to_string(VarType t);
+// name of the type in cern (ex: int[16], Particle[64] @soa)
+std::string to_string(const VarType& t);
 VarType to_variable_type(TokenType t);
 
 namespace Node {
@@ -37,6 +132,11 @@ namespace Node {
         Token int_lit;
     };
 
+    // 1.5f or 1.5
+    struct TermFloatLiteral {
+        Token float_lit;
+    };
+
     struct TermCharLiteral {
         Token char_lit;
     };
@@ -54,15 +154,61 @@ namespace Node {
         Expr* expr;
     };
 
+    // type(args): numeric conversion (float(i)), vector constructor (vec3(x, y, z), vec3(s))
+    // or struct constructor (Particle(pos, vel), one value per field)
+    struct TermConstruct {
+        VarType type;
+        std::vector<Expr*> args;
+    };
+
+    // Enum.Value
+    struct TermEnumValue {
+        Token ident;
+        Token value;
+        // position of the value in the declaration of the enum
+        size_t index;
+    };
+
+    struct Term;
+
+    // base.field
+    struct TermField {
+        Term* base;
+        Token field;
+    };
+
+    // base[index]
+    struct TermIndex {
+        Term* base;
+        Expr* index;
+        // line of the `[`, reported by the bounds checks
+        int line;
+    };
+
+    // base[begin..end], a str_view of the characters of a string or a view, end excluded
+    struct TermSlice {
+        Term* base;
+        Expr* begin;
+        Expr* end;
+        // line of the `[`, reported by the bounds checks
+        int line;
+    };
+
     struct Term {
         std::variant<
             TermBooleanLiteral*,
             TermIntegerLiteral*,
+            TermFloatLiteral*,
             TermCharLiteral*,
             TermStringLiteral*,
             TermIdentifier*,
             FuncCall*,
-            TermParen*>
+            TermParen*,
+            TermConstruct*,
+            TermEnumValue*,
+            TermField*,
+            TermIndex*,
+            TermSlice*>
             var;
         VarType type{ VarType::VOID };
     };
@@ -127,12 +273,49 @@ namespace Node {
         Expr* rside;
     };
 
+    struct BinExprMod {
+        Expr* lside;
+        Expr* rside;
+    };
+
+    struct BinExprBitAnd {
+        Expr* lside;
+        Expr* rside;
+    };
+
+    struct BinExprBitOr {
+        Expr* lside;
+        Expr* rside;
+    };
+
+    struct BinExprBitXor {
+        Expr* lside;
+        Expr* rside;
+    };
+
+    struct BinExprShl {
+        Expr* lside;
+        Expr* rside;
+    };
+
+    struct BinExprShr {
+        Expr* lside;
+        Expr* rside;
+    };
+
     struct BinExpr {
         std::variant<
             BinExprAdd*,
             BinExprSub*,
             BinExprMulti*,
             BinExprDiv*,
+            BinExprMod*,
+
+            BinExprBitAnd*,
+            BinExprBitOr*,
+            BinExprBitXor*,
+            BinExprShl*,
+            BinExprShr*,
 
             BinExprAnd*,
             BinExprOr*,
@@ -143,12 +326,19 @@ namespace Node {
             BinExprLowerOrEqual*,
             BinExprLower*
         > var;
+        // operator token, to parenthesize the generated code where c++ groups differently
+        TokenType op;
     };
 
     struct ExprNot {
         Expr* expr;
     };
 
+    // ~expr
+    struct ExprBitNot {
+        Expr* expr;
+    };
+
     struct VarIncr {
         TermIdentifier* ident;
     };
@@ -162,6 +352,7 @@ namespace Node {
             Term*,
             BinExpr*,
             ExprNot*,
+            ExprBitNot*,
             VarIncr*,
             VarDecr*
         > var;
@@ -171,20 +362,61 @@ namespace Node {
     struct ScopeStmt;
 
     // var ident = value
+    // var ident : type = value
     struct StmtImplicitVar {
         Token identifier;
         Expr* expr;
+        VarType type{ VarType::VOID };
     };
 
     // var ident : type
     struct StmtExplicitVar {
         Token ident;
         VarType type;
+        // a list declared in a frame takes its memory from the frame arena
+        bool frame{ false };
+    };
+
+    // const ident = value
+    // const ident : type = value
+    struct StmtConst {
+        Token ident;
+        Expr* expr;
+        VarType type{ VarType::VOID };
+    };
+
+    // ident : type
+    // ref ident : type
+    struct Param {
+        Token ident;
+        VarType type;
+        // passed by reference, the function can modify the argument
+        bool ref{ false };
+    };
+
+    // ident : type
+    struct Field {
+        Token ident;
+        VarType type;
+    };
+
+    // struct ident { fields }
+    struct StructDeclaration {
+        Token ident;
+        std::vector<Field*> fields;
+    };
+
+    // enum ident { values }
+    struct EnumDeclaration {
+        Token ident;
+        std::vector<Token> values;
     };
 
-    // func indent() { ? }
+    // func indent(params) { ? }
     struct FuncDeclaration {
         Token ident;
+        std::vector<Param*> params;
+        // null for a function of an imported module, only its signature is known
         Scope* scope;
         VarType type{ VarType::VOID };
     };
@@ -194,6 +426,13 @@ namespace Node {
         Expr* expr;
     };
 
+    // ident[index] = value
+    // ident.field = value
+    struct StmtElemAssign {
+        Term* target;
+        Expr* expr;
+    };
+
     struct StmtReturn {
         Expr* expr;
     };
@@ -203,6 +442,45 @@ namespace Node {
         Scope* scope;
     };
 
+    // begin..end, end excluded
+    struct Range {
+        Expr* begin;
+        Expr* end;
+        // type of the induction variable
+        VarType type;
+    };
+
+    // for ident in range step ? { ? }
+    struct StmtFor {
+        Token ident;
+        Range* range;
+        // increment of the induction variable, 1 if absent
+        std::optional<Expr*> step;
+        Scope* scope;
+    };
+
+    // parallel for ident in range grain ? { ? }
+    struct StmtParallelFor {
+        Token ident;
+        Range* range;
+        // iterations per chunk, chosen by the runtime if absent
+        std::optional<Expr*> grain;
+        Scope* scope;
+    };
+
+    // frame { ? }, the lists declared in it are released at once when it ends
+    struct StmtFrame {
+        Scope* scope;
+    };
+
+    // bench(name, runs ?) { ? }, the body runs `runs` times and the time of a run is printed
+    struct StmtBench {
+        Expr* name;
+        // 100 if absent
+        std::optional<Expr*> runs;
+        Scope* scope;
+    };
+
     struct IfPred;
 
     struct IfPredElif {
@@ -225,17 +503,44 @@ namespace Node {
         std::optional<IfPred*> pred;
     };
 
+    // values `first` to `last` (included) handled by a match arm, wide enough for any i64 or u64
+    struct MatchCase {
+        __int128 first;
+        __int128 last;
+    };
+
+    // cases => { ? }, no case for `else`
+    struct MatchArm {
+        std::vector<MatchCase> cases;
+        Scope* scope;
+    };
+
+    // match ( ? ) { arms }
+    struct StmtMatch {
+        Expr* expr;
+        std::vector<MatchArm*> arms;
+        // an `else` arm handles the values of no case, without it every value has a case
+        bool has_else = false;
+    };
+
     struct ScopeStmt {
         std::variant<
             Scope*,
             StmtImplicitVar*,
             StmtExplicitVar*,
+            StmtConst*,
             StmtVarAssign*,
+            StmtElemAssign*,
             FuncCall*,
             VarIncr*,
             VarDecr*,
             StmtReturn*,
             StmtWhile*,
+            StmtFor*,
+            StmtParallelFor*,
+            StmtFrame*,
+            StmtBench*,
+            StmtMatch*,
             StmtIf*
         > var;
         std::optional<VarType> type{};
@@ -246,11 +551,24 @@ namespace Node {
         VarType type{ VarType::VOID };
     };
 
+    struct ProgStmt;
+
+    // import "file.ce"
+    struct Import {
+        Token path;
+        // declarations of the module and of the modules it imports, those already imported excluded
+        std::vector<ProgStmt*> decls;
+    };
+
     struct ProgStmt {
         std::variant<
+            Import*,
             FuncDeclaration*,
+            StructDeclaration*,
+            EnumDeclaration*,
             StmtImplicitVar*,
-            StmtExplicitVar*
+            StmtExplicitVar*,
+            StmtConst*
         > var;
     };
 
@@ -260,9 +578,13 @@ namespace Node {
 }
 
 class Parser {
+public:
+    // value of a constant: integers, bools, chars and enum values as integers, float and double as double
+    using ConstValue = std::variant<__int128, double>;
+
 private:
-    // contains every token in order
-    const std::vector<Token> tokens;
+    // contains every token in order (a `>>` closing two types is split in place)
+    std::vector<Token> tokens;
 
     // current token index
     size_t index = 0;
@@ -275,14 +597,152 @@ private:
     // check if an identifier is a buildin function
     static bool is_buildin_func(const std::string& func);
 
+    // return type of a call to a buildin function (some depend on the arguments, like pop)
+    VarType buildin_call_type(const Node::FuncCall* fcall);
+
     // map the identifiers (vars and funcs) with their return type
-    static std::unordered_map<std::string, VarType> identifiers;
+    std::unordered_map<std::string, VarType> identifiers;
 
     // check if an identifier exist or not
-    static bool is_var(const std::string& var);
+    bool is_var(const std::string& var) const;
+
+    // map the user functions with their declaration, to check the arguments of the calls
+    std::unordered_map<std::string, Node::FuncDeclaration*> functions;
+
+    // map the struct names with their declaration
+    std::unordered_map<std::string, Node::StructDeclaration*> structs;
+
+    // map the enum names with their declaration
+    std::unordered_map<std::string, Node::EnumDeclaration*> enums;
+
+    // position of `value` in the enum `t`
+    size_t enum_index(const VarType& t, const Token& value);
+
+    // field `name` of the struct `t`
+    const Node::Field* field(const VarType& t, const std::string& name);
+
+    // identifiers that cannot be modified, with what they are for the error (ex: "parameter 'a' (add `ref` to modify it)")
+    std::unordered_map<std::string, std::string> immutables;
+
+    // map the constants with their value, folded when they are declared
+    std::unordered_map<std::string, ConstValue> constants;
+
+    // value of an expression made of literals, constants and operators, nothing if it is only known at run time
+    // (exit with an error if its evaluation is invalid, like a division by zero)
+    std::optional<ConstValue> fold(const Node::Expr* e);
+
+    std::optional<ConstValue> fold(const Node::Term* t);
+
+    // value of the integer or char constant `ident`, if it is one
+    std::optional<__int128> int_constant(const Token& ident) const;
+
+    // identifiers declared in each open scope, innermost last
+    std::vector<std::vector<std::string>> scopes;
+
+    void begin_scope();
+
+    // forget the identifiers declared in the innermost scope
+    void end_scope();
+
+    // register an identifier in the innermost scope (global if no scope is open)
+    void declare(const Token& ident, const VarType& type);
+
+    // true if the identifier was declared in the scope `depth` or deeper
+    bool declared_since(const std::string& ident, size_t depth) const;
+
+    // function being parsed, if any
+    std::optional<std::string> current_func;
+
+    // functions writing to global variables (directly or through the functions they call)
+    std::unordered_set<std::string> global_writers;
+
+    // line of a call of the function being parsed to itself in a parallel for, checked once its body
+    // is parsed: a global it writes after the call is not known yet
+    std::optional<int> parallel_self_call;
+
+    // exit with an error if the function being parsed calls itself in a parallel for and writes to globals
+    void check_parallel_self_call();
+
+    struct ParallelLoop {
+        // induction variable
+        std::string var;
+        // scope depth of the body, what is declared deeper is local to an iteration
+        size_t depth;
+        // outer variables the body writes to, through var
+        std::unordered_set<std::string> written;
+        // outer variables the body reads, and whether they are indexed by var (false when used whole)
+        std::vector<std::pair<std::string, bool>> indexed;
+    };
+
+    // innermost parallel for being parsed, if any
+    std::optional<ParallelLoop> parallel;
+
+    // number of frames enclosing the statement being parsed (in the function or the parallel for body being parsed)
+    size_t frame_depth = 0;
+
+    // number of benches enclosing the statement being parsed, their body cannot return
+    size_t bench_depth = 0;
+
+    // str_view variables in the open scopes, with the string variables they may point into
+    std::unordered_map<std::string, std::vector<std::string>> view_roots;
+
+    // string variables a str_view (or string) expression may point into, "" for a temporary string
+    std::vector<std::string> viewed_strings(const Node::Expr* e);
+
+    std::vector<std::string> viewed_strings(const Node::Term* t);
+
+    // 0 for a global, 1 for a parameter, deeper for the locals
+    size_t scope_depth(const std::string& ident) const;
+
+    // exit with an error if the view `e`, stored into a variable declared at `depth` ("" for a return
+    // value), could outlive a string it points into; return the strings it points into
+    std::vector<std::string> check_view_lifetime(const Node::Expr* e, size_t depth, const std::string& target);
+
+    // exit with an error if the string `ident` is about to be modified while a view points into it
+    void check_not_viewed(const std::string& ident);
+
+    // exit with an error if `fcall`, which may write to globals, is called while a view points into a global,
+    // or is given a global string or a view into one
+    void check_no_global_view(const Node::FuncCall* fcall);
+
+    // a string converts to a view of it where a str_view is expected
+    static bool converts(const VarType& from, const VarType& to);
+
+    // exit with an error if a view is stored in a container or a struct, where its lifetime is not checked
+    void check_storable(const VarType& t, const std::string& where);
+
+    // true if the expression is the induction variable of the parallel for
+    bool is_parallel_index(const Node::Expr* e) const;
+
+    // exit with an error if the identifier is a parameter not passed by reference,
+    // or an outer variable of a parallel for not written through its induction variable
+    // (index is the index applied to the variable, as in xs[index].pos)
+    void check_mutable(const Token& ident, const Node::Expr* index = nullptr);
+
+    // exit with an error if the term is not a variable (or an element of one) that can be modified
+    void check_mutable(const Node::Term* t);
+
+    void check_mutable(const Node::Expr* e);
+
+    // check the number and types of the arguments of a call to a user function
+    void check_args(const Node::FuncCall* fcall);
+
+    // variable an argument designates (empty for a computed value), and whether it is the whole variable
+    // rather than an element or a field of it
+    static std::pair<std::string, bool> argument_root(const Node::Expr* e);
 
     static std::optional<VarType> get_return_type(VarType t1, TokenType op, VarType t2);
 
+    // integer type of the result of an arithmetic operation between two integers
+    static VarType promote(const VarType& t1, const VarType& t2);
+
+    // declared return type of the function being parsed, if any
+    std::optional<VarType> return_type;
+
+    // an integer literal takes the integer type expected where it is used, if its value fits
+    // (exit with an error otherwise, unless check_range is false); so does an integer constant, left as is if it does not fit
+    void coerce_literal(Node::Expr* e, const VarType& t, bool check_range = true);
+
     // parse the type associated with an identifier
     std::optional<VarType> var_type(const std::string& ident);
 
@@ -306,26 +766,108 @@ private:
     /// @param template_msg balise of it (ex: missing, expected, ...)
     void exit_with(const std::string& err_msg, std::string template_msg = "missing");
 
+private:
+    // interfaces of the modules imported by the program, by the path written in the `import`
+    std::unordered_map<std::string, const module::Interface*> imports;
+
+    // modules whose declarations are already registered (a module imported twice, directly or not)
+    std::unordered_set<const module::Interface*> imported;
+
+    // register the declarations of a module after the ones of the modules it imports, and append them to `decls`
+    void import_module(const module::Interface* m, std::vector<Node::ProgStmt*>& decls);
+
 public:
-    Parser(std::vector<Token> tokens);
+    // `imports` are the interfaces of the modules the tokens import, built beforehand
+    Parser(std::vector<Token> tokens, std::unordered_map<std::string, const module::Interface*> imports = {});
+
+    // value of the constant `ident`, if it is one
+    std::optional<ConstValue> constant(const std::string& ident) const;
+
+    // true if the function writes to global variables, directly or through the functions it calls
+    bool writes_globals(const std::string& func) const;
+
+    // number of AST nodes allocated so far
+    size_t node_count() const;
+
+    // allocator holding the AST
+    const ArenaAllocator& arena() const;
 
     std::optional<Node::Prog> parse_prog();
 
     std::optional<Node::ProgStmt*> parse_prog_stmt();
 
+    // parse `import "file.ce"`
+    std::optional<Node::Import*> parse_import();
+
+    // parse `struct Name { field : type ... }`
+    std::optional<Node::StructDeclaration*> parse_struct();
+
+    // parse `enum Name { A, B, C }`
+    std::optional<Node::EnumDeclaration*> parse_enum();
+
+    // parse `(a : int, ref b : string)` after a function name
+    std::vector<Node::Param*> parse_params();
+
     std::optional<Node::Scope*> parse_scope();
 
     std::optional<Node::ScopeStmt*> parse_scope_stmt();
 
+    // parse `var ident = value`, `var ident : type = value` or `var ident : type`
+    std::optional<std::variant<Node::StmtImplicitVar*, Node::StmtExplicitVar*>> parse_var_declaration();
+
+    // parse `const ident = value` or `const ident : type = value`
+    std::optional<Node::StmtConst*> parse_const();
+
+    std::optional<Node::FuncCall*> parse_func_call();
+
     std::vector<Node::Expr*> parse_args();
 
     std::optional<Node::IfPred*> parse_if_pred();
 
+    // parse `begin..end`
+    Node::Range* parse_range();
+
+    // parse `for ident in range [step n] { ? }`
+    std::optional<Node::StmtFor*> parse_for();
+
+    // parse `match (expr) { arms }`
+    std::optional<Node::StmtMatch*> parse_match();
+
+    // value of a literal case of a match over `t`, `-` before a literal makes it negative
+    __int128 parse_match_value(const VarType& t);
+
+    // check that no value has two arms, and that every value has one if there is no `else`
+    void check_match_cases(const Node::StmtMatch* stmt);
+
+    // parse `parallel for ident in range [grain n] { ? }`
+    std::optional<Node::StmtParallelFor*> parse_parallel_for();
+
+    // parse `frame { ? }`
+    std::optional<Node::StmtFrame*> parse_frame();
+
+    // parse `bench(name [, runs]) { ? }`
+    std::optional<Node::StmtBench*> parse_bench();
+
     std::optional<Node::Expr*> parse_expr(int min_prec = 0);
 
+    // parse `!term` or `~term`, the prefix operators bind tighter than any binary one
+    std::optional<Node::Expr*> parse_unary();
+
+    // consume the `>` closing `list<`, or the first half of a `>>`
+    void consume_closing_angle();
+
     std::optional<Node::Term*> parse_term();
 
     std::optional<Node::TermIdentifier*> parse_identifier();
 
+    // parse `type(args)`
+    std::optional<Node::TermConstruct*> parse_construct();
+
+    // parse the `[index]` and `.field` following a term, if any
+    Node::Term* parse_postfix(Node::Term* term);
+
     std::optional<VarType> parse_type();
+
+    // parse bool, an integer type, char, string, float, double, a vector type or a struct name
+    std::optional<VarType> parse_scalar_type();
 };
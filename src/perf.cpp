@@ -0,0 +1,164 @@
+#include "perf.h"
+
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace perf {
+    std::string to_string(Counter c) {
+        switch (c) {
+        case Counter::CYCLES:
+            return "cycles";
+        case Counter::INSTRUCTIONS:
+            return "instructions";
+        case Counter::BRANCH_MISSES:
+            return "branch-misses";
+        case Counter::L1D_MISSES:
+            return "L1d-misses";
+        case Counter::LLC_MISSES:
+            return "LLC-misses";
+        default:
+            return "";
+        }
+    }
+
+#ifdef __linux__
+    namespace {
+        void describe(Counter c, perf_event_attr& attr) {
+            switch (c) {
+            case Counter::CYCLES:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case Counter::INSTRUCTIONS:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case Counter::BRANCH_MISSES:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            case Counter::L1D_MISSES:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = PERF_COUNT_HW_CACHE_L1D
+                    | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                break;
+            case Counter::LLC_MISSES:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_CACHE_MISSES;
+                break;
+            default:
+                break;
+            }
+        }
+
+        int open_counter(Counter c) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            describe(c, attr);
+            attr.disabled = 1;
+            // user space only, this is what an unprivileged process is usually allowed to count
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            // also count the children, so the backend and modules phases include the c++ compiler
+            attr.inherit = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+    }
+
+    Counters::Counters() {
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            _fds[c] = open_counter(static_cast<Counter>(c));
+
+            if (_fds[c] < 0 && _error.empty()) {
+                _error = to_string(static_cast<Counter>(c)) + ": " + std::strerror(errno);
+                if (errno == EACCES || errno == EPERM)
+                    _error += " (see /proc/sys/kernel/perf_event_paranoid)";
+            }
+        }
+    }
+
+    Counters::~Counters() {
+        for (const int fd : _fds)
+            if (fd >= 0)
+                close(fd);
+    }
+
+    // a reset does not clear what the children that already exited added to an inherited counter:
+    // a period is the difference between two reads instead
+    void Counters::start() {
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (_fds[c] < 0)
+                continue;
+            if (read(_fds[c], _start[c].data(), sizeof(_start[c])) != sizeof(_start[c]))
+                _start[c].fill(0);
+            ioctl(_fds[c], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    Sample Counters::stop() {
+        Sample sample{};
+
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (_fds[c] < 0)
+                continue;
+
+            ioctl(_fds[c], PERF_EVENT_IOC_DISABLE, 0);
+
+            // value, time enabled, time running
+            uint64_t values[3];
+            if (read(_fds[c], values, sizeof(values)) != sizeof(values))
+                continue;
+
+            for (int i = 0; i < 3; i++)
+                values[i] -= _start[c][i];
+
+            if (values[2] == 0)
+                continue;
+
+            if (values[2] < values[1])
+                values[0] = static_cast<uint64_t>(static_cast<double>(values[0]) * values[1] / values[2]);
+
+            sample[c] = values[0];
+        }
+
+        return sample;
+    }
+#else
+    Counters::Counters()
+        : _error("hardware counters are only supported on linux") {
+        _fds.fill(-1);
+    }
+
+    Counters::~Counters() {
+    }
+
+    void Counters::start() {
+    }
+
+    Sample Counters::stop() {
+        return {};
+    }
+#endif
+
+    bool Counters::available() const {
+        for (const int fd : _fds)
+            if (fd >= 0)
+                return true;
+        return false;
+    }
+
+    const std::string& Counters::error() const {
+        return _error;
+    }
+}
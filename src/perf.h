@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <string>
+#include <cstdint>
+
+/// @brief hardware performance counters read with perf_event_open (linux only)
+namespace perf {
+    enum Counter {
+        CYCLES,
+        INSTRUCTIONS,
+        BRANCH_MISSES,
+        L1D_MISSES,
+        LLC_MISSES,
+        COUNTER_COUNT
+    };
+
+    /// @brief basic conversion function
+    /// @return short name of the counter used in the reports
+    std::string to_string(Counter c);
+
+    /// @brief value of every counter over a period (empty if the counter could not be opened)
+    using Sample = std::array<std::optional<uint64_t>, COUNTER_COUNT>;
+
+    /// @brief the counters of the calling thread; each one is opened on its own so that the
+    /// ones the kernel or the cpu refuse are simply missing from the samples
+    class Counters {
+    private:
+        std::array<int, COUNTER_COUNT> _fds;
+        std::string _error;
+        // value, time enabled and time running of each counter when the period started
+        std::array<std::array<uint64_t, 3>, COUNTER_COUNT> _start{};
+
+    public:
+        /// @brief open every counter (they are not counting yet)
+        Counters();
+
+        Counters(const Counters&) = delete;
+        Counters& operator=(const Counters&) = delete;
+
+        ~Counters();
+
+        /// @return true if at least one counter could be opened
+        bool available() const;
+
+        /// @return why the first refused counter could not be opened (ex: not permitted)
+        const std::string& error() const;
+
+        /// @brief start every counter, remembering where it stands
+        void start();
+
+        /// @brief stop every counter
+        /// @return their value since the last call to start, scaled if the kernel multiplexed them
+        Sample stop();
+    };
+}
@@ -6,28 +6,86 @@ std::string to_string(const TokenType type) {
         return "return value";
     case TokenType::VAR:
         return "var";
+    case TokenType::CONST:
+        return "const";
     case TokenType::FUNC:
         return "func";
+    case TokenType::STRUCT:
+        return "struct";
+    case TokenType::ENUM:
+        return "enum";
+    case TokenType::IMPORT:
+        return "import";
+    case TokenType::REF:
+        return "ref";
     case TokenType::IDENTIFIER:
         return "identifier";
     case TokenType::TYPE_BOOL:
         return "bool";
     case TokenType::TYPE_INT:
         return "int";
+    case TokenType::TYPE_I8:
+        return "i8";
+    case TokenType::TYPE_I16:
+        return "i16";
+    case TokenType::TYPE_I64:
+        return "i64";
+    case TokenType::TYPE_U8:
+        return "u8";
+    case TokenType::TYPE_U16:
+        return "u16";
+    case TokenType::TYPE_U32:
+        return "u32";
+    case TokenType::TYPE_U64:
+        return "u64";
     case TokenType::TYPE_CHAR:
         return "char";
     case TokenType::TYPE_STRING:
         return "string";
+    case TokenType::TYPE_FLOAT:
+        return "float";
+    case TokenType::TYPE_DOUBLE:
+        return "double";
+    case TokenType::TYPE_VEC2:
+        return "vec2";
+    case TokenType::TYPE_VEC3:
+        return "vec3";
+    case TokenType::TYPE_VEC4:
+        return "vec4";
+    case TokenType::TYPE_LIST:
+        return "list";
+    case TokenType::TYPE_MAP:
+        return "map";
+    case TokenType::TYPE_BYTES:
+        return "bytes";
+    case TokenType::TYPE_STR_VIEW:
+        return "str_view";
     case TokenType::BOOLEAN_LITEARL:
         return "boolean literal";
     case TokenType::INTEGER_LITERAL:
         return "integer literal";
+    case TokenType::FLOAT_LITERAL:
+        return "float literal";
+    case TokenType::DOUBLE_LITERAL:
+        return "double literal";
     case TokenType::CHAR_LITERAL:
         return "char literal";
     case TokenType::STRING_LITERAL:
         return "string literal";
     case TokenType::WHILE:
         return "while";
+    case TokenType::FOR:
+        return "for";
+    case TokenType::IN:
+        return "in";
+    case TokenType::PARALLEL:
+        return "parallel";
+    case TokenType::FRAME:
+        return "frame";
+    case TokenType::BENCH:
+        return "bench";
+    case TokenType::MATCH:
+        return "match";
     case TokenType::IF:
         return "if";
     case TokenType::ELIF:
@@ -48,6 +106,20 @@ std::string to_string(const TokenType type) {
         return "{";
     case TokenType::RIGHT_CURLY_BRACKET:
         return "}";
+    case TokenType::LEFT_SQUARE_BRACKET:
+        return "[";
+    case TokenType::RIGHT_SQUARE_BRACKET:
+        return "]";
+    case TokenType::DOT:
+        return ".";
+    case TokenType::RANGE:
+        return "..";
+    case TokenType::RANGE_INCLUSIVE:
+        return "..=";
+    case TokenType::ARROW:
+        return "=>";
+    case TokenType::AT:
+        return "@";
     case TokenType::PLUS:
         return "+";
     case TokenType::MINUS:
@@ -56,6 +128,20 @@ std::string to_string(const TokenType type) {
         return "*";
     case TokenType::SLASH:
         return "/";
+    case TokenType::PERCENT:
+        return "%";
+    case TokenType::BIT_AND:
+        return "&";
+    case TokenType::BIT_OR:
+        return "|";
+    case TokenType::BIT_XOR:
+        return "^";
+    case TokenType::BIT_NOT:
+        return "~";
+    case TokenType::SHIFT_LEFT:
+        return "<<";
+    case TokenType::SHIFT_RIGHT:
+        return ">>";
     case TokenType::INCREMENTATOR:
         return "++";
     case TokenType::DECREMENTATOR:
@@ -84,27 +170,43 @@ std::string to_string(const TokenType type) {
 }
 
 std::optional<int> op_prec(TokenType type) {
+    // the bitwise operators bind tighter than the comparisons (x & 1 == 0 is (x & 1) == 0)
     switch (type) {
+    case TokenType::OR:
+        return 0;
+    case TokenType::AND:
+        return 1;
+
     case TokenType::IS_EQUAL:
     case TokenType::IS_NOT_EQUAL:
+        return 2;
+
     case TokenType::GREATER_OR_EQUAL:
     case TokenType::GREATER:
     case TokenType::LOWER_OR_EQUAL:
     case TokenType::LOWER:
+        return 3;
+
+    case TokenType::BIT_OR:
+        return 4;
+    case TokenType::BIT_XOR:
+        return 5;
+    case TokenType::BIT_AND:
+        return 6;
+
+    case TokenType::SHIFT_LEFT:
+    case TokenType::SHIFT_RIGHT:
+        return 7;
 
     case TokenType::PLUS:
     case TokenType::MINUS:
-    case TokenType::INCREMENTATOR:
-    case TokenType::DECREMENTATOR:
-        return 0;
-
-    case TokenType::NOT:
-    case TokenType::AND:
-    case TokenType::OR:
+        return 8;
 
     case TokenType::STAR:
     case TokenType::SLASH:
-        return 1;
+    case TokenType::PERCENT:
+        return 9;
+
     default:
         return {};
     }
@@ -161,12 +263,44 @@ std::vector<Token> Tokenizer::tokenize() {
             // TYPES
             if (buf == "bool")
                 tokens.push_back({ .type = TokenType::TYPE_BOOL, .line = line_count });
-            else if (buf == "int")
+            else if (buf == "int" || buf == "i32")
                 tokens.push_back({ .type = TokenType::TYPE_INT, .line = line_count });
+            else if (buf == "i8")
+                tokens.push_back({ .type = TokenType::TYPE_I8, .line = line_count });
+            else if (buf == "i16")
+                tokens.push_back({ .type = TokenType::TYPE_I16, .line = line_count });
+            else if (buf == "i64")
+                tokens.push_back({ .type = TokenType::TYPE_I64, .line = line_count });
+            else if (buf == "u8")
+                tokens.push_back({ .type = TokenType::TYPE_U8, .line = line_count });
+            else if (buf == "u16")
+                tokens.push_back({ .type = TokenType::TYPE_U16, .line = line_count });
+            else if (buf == "u32")
+                tokens.push_back({ .type = TokenType::TYPE_U32, .line = line_count });
+            else if (buf == "u64")
+                tokens.push_back({ .type = TokenType::TYPE_U64, .line = line_count });
             else if (buf == "char")
                 tokens.push_back({ .type = TokenType::TYPE_CHAR, .line = line_count });
             else if (buf == "string")
                 tokens.push_back({ .type = TokenType::TYPE_STRING, .line = line_count });
+            else if (buf == "float")
+                tokens.push_back({ .type = TokenType::TYPE_FLOAT, .line = line_count });
+            else if (buf == "double")
+                tokens.push_back({ .type = TokenType::TYPE_DOUBLE, .line = line_count });
+            else if (buf == "vec2")
+                tokens.push_back({ .type = TokenType::TYPE_VEC2, .line = line_count });
+            else if (buf == "vec3")
+                tokens.push_back({ .type = TokenType::TYPE_VEC3, .line = line_count });
+            else if (buf == "vec4")
+                tokens.push_back({ .type = TokenType::TYPE_VEC4, .line = line_count });
+            else if (buf == "list")
+                tokens.push_back({ .type = TokenType::TYPE_LIST, .line = line_count });
+            else if (buf == "map")
+                tokens.push_back({ .type = TokenType::TYPE_MAP, .line = line_count });
+            else if (buf == "bytes")
+                tokens.push_back({ .type = TokenType::TYPE_BYTES, .line = line_count });
+            else if (buf == "str_view")
+                tokens.push_back({ .type = TokenType::TYPE_STR_VIEW, .line = line_count });
 
             // KEYWORDS
             else if (buf == "true")
@@ -175,12 +309,34 @@ std::vector<Token> Tokenizer::tokenize() {
                 tokens.push_back({ .type = TokenType::BOOLEAN_LITEARL, .line = line_count, .val = "false" });
             else if (buf == "var")
                 tokens.push_back({ .type = TokenType::VAR, .line = line_count });
+            else if (buf == "const")
+                tokens.push_back({ .type = TokenType::CONST, .line = line_count });
             else if (buf == "func")
                 tokens.push_back({ .type = TokenType::FUNC, .line = line_count });
+            else if (buf == "struct")
+                tokens.push_back({ .type = TokenType::STRUCT, .line = line_count });
+            else if (buf == "enum")
+                tokens.push_back({ .type = TokenType::ENUM, .line = line_count });
+            else if (buf == "import")
+                tokens.push_back({ .type = TokenType::IMPORT, .line = line_count });
+            else if (buf == "ref")
+                tokens.push_back({ .type = TokenType::REF, .line = line_count });
             else if (buf == "return")
                 tokens.push_back({ .type = TokenType::RETURN, .line = line_count });
             else if (buf == "while")
                 tokens.push_back({ .type = TokenType::WHILE, .line = line_count });
+            else if (buf == "for")
+                tokens.push_back({ .type = TokenType::FOR, .line = line_count });
+            else if (buf == "in")
+                tokens.push_back({ .type = TokenType::IN, .line = line_count });
+            else if (buf == "parallel")
+                tokens.push_back({ .type = TokenType::PARALLEL, .line = line_count });
+            else if (buf == "frame")
+                tokens.push_back({ .type = TokenType::FRAME, .line = line_count });
+            else if (buf == "bench")
+                tokens.push_back({ .type = TokenType::BENCH, .line = line_count });
+            else if (buf == "match")
+                tokens.push_back({ .type = TokenType::MATCH, .line = line_count });
             else if (buf == "if")
                 tokens.push_back({ .type = TokenType::IF, .line = line_count });
             else if (buf == "elif")
@@ -197,9 +353,25 @@ std::vector<Token> Tokenizer::tokenize() {
             while (peek().has_value() && std::isdigit(peek().value())) {
                 buf.push_back(consume());
             }
-            tokens.push_back({ .type = TokenType::INTEGER_LITERAL,
-                              .line = line_count,
-                              .val = buf });
+
+            // 1.5 is a double and 1.5f a float
+            if (peek().has_value() && peek().value() == '.' && peek(1).has_value() && std::isdigit(peek(1).value())) {
+                buf.push_back(consume());
+                while (peek().has_value() && std::isdigit(peek().value())) {
+                    buf.push_back(consume());
+                }
+
+                if (peek().has_value() && peek().value() == 'f') {
+                    buf.push_back(consume());
+                    tokens.push_back({ .type = TokenType::FLOAT_LITERAL, .line = line_count, .val = buf });
+                }
+                else
+                    tokens.push_back({ .type = TokenType::DOUBLE_LITERAL, .line = line_count, .val = buf });
+            }
+            else
+                tokens.push_back({ .type = TokenType::INTEGER_LITERAL,
+                                  .line = line_count,
+                                  .val = buf });
             buf.clear();
         }
         else if (peek().value() == '=') {
@@ -209,6 +381,10 @@ std::vector<Token> Tokenizer::tokenize() {
                 consume();
                 tokens.push_back({ .type = TokenType::IS_EQUAL, .line = line_count });
             }
+            else if (peek().has_value() && peek().value() == '>') {
+                consume();
+                tokens.push_back({ .type = TokenType::ARROW, .line = line_count });
+            }
             else
                 tokens.push_back({ .type = TokenType::EQUAL, .line = line_count });
         }
@@ -236,6 +412,34 @@ std::vector<Token> Tokenizer::tokenize() {
             consume();
             tokens.push_back({ .type = TokenType::RIGHT_CURLY_BRACKET, .line = line_count });
         }
+        else if (peek().value() == '[') {
+            consume();
+            tokens.push_back({ .type = TokenType::LEFT_SQUARE_BRACKET, .line = line_count });
+        }
+        else if (peek().value() == ']') {
+            consume();
+            tokens.push_back({ .type = TokenType::RIGHT_SQUARE_BRACKET, .line = line_count });
+        }
+        else if (peek().value() == '.') {
+            consume();
+
+            if (peek().has_value() && peek().value() == '.') {
+                consume();
+
+                if (peek().has_value() && peek().value() == '=') {
+                    consume();
+                    tokens.push_back({ .type = TokenType::RANGE_INCLUSIVE, .line = line_count });
+                }
+                else
+                    tokens.push_back({ .type = TokenType::RANGE, .line = line_count });
+            }
+            else
+                tokens.push_back({ .type = TokenType::DOT, .line = line_count });
+        }
+        else if (peek().value() == '@') {
+            consume();
+            tokens.push_back({ .type = TokenType::AT, .line = line_count });
+        }
         else if (peek().value() == '+') {
             consume();
 
@@ -264,6 +468,18 @@ std::vector<Token> Tokenizer::tokenize() {
             consume();
             tokens.push_back({ .type = TokenType::SLASH, .line = line_count });
         }
+        else if (peek().value() == '%') {
+            consume();
+            tokens.push_back({ .type = TokenType::PERCENT, .line = line_count });
+        }
+        else if (peek().value() == '^') {
+            consume();
+            tokens.push_back({ .type = TokenType::BIT_XOR, .line = line_count });
+        }
+        else if (peek().value() == '~') {
+            consume();
+            tokens.push_back({ .type = TokenType::BIT_NOT, .line = line_count });
+        }
         else if (peek().value() == '!') {
             consume();
 
@@ -277,29 +493,35 @@ std::vector<Token> Tokenizer::tokenize() {
         else if (peek().value() == '&') {
             consume();
 
-            if (!peek().has_value() || peek().value() != '&') {
-                std::cerr << "expected `&` on line " << line_count << std::endl;
-                exit(EXIT_FAILURE);
+            if (peek().has_value() && peek().value() == '&') {
+                consume();
+                tokens.push_back({ .type = TokenType::AND, .line = line_count });
             }
-            tokens.push_back({ .type = TokenType::AND, .line = line_count });
+            else
+                tokens.push_back({ .type = TokenType::BIT_AND, .line = line_count });
         }
         else if (peek().value() == '|') {
             consume();
 
-            if (!peek().has_value() || peek().value() != '|') {
-                std::cerr << "expected `|` on line " << line_count << std::endl;
-                exit(EXIT_FAILURE);
+            if (peek().has_value() && peek().value() == '|') {
+                consume();
+                tokens.push_back({ .type = TokenType::OR, .line = line_count });
             }
-
-            tokens.push_back({ .type = TokenType::OR, .line = line_count });
+            else
+                tokens.push_back({ .type = TokenType::BIT_OR, .line = line_count });
         }
         else if (peek().value() == '>') {
             consume();
 
+            // `>>` closes two nested types in list<list<int>>, the parser splits it there
             if (peek().has_value() && peek().value() == '=') {
                 consume();
                 tokens.push_back({ .type = TokenType::GREATER_OR_EQUAL, .line = line_count });
             }
+            else if (peek().has_value() && peek().value() == '>') {
+                consume();
+                tokens.push_back({ .type = TokenType::SHIFT_RIGHT, .line = line_count });
+            }
             else
                 tokens.push_back({ .type = TokenType::GREATER, .line = line_count });
         }
@@ -310,13 +532,18 @@ std::vector<Token> Tokenizer::tokenize() {
                 consume();
                 tokens.push_back({ .type = TokenType::LOWER_OR_EQUAL, .line = line_count });
             }
+            else if (peek().has_value() && peek().value() == '<') {
+                consume();
+                tokens.push_back({ .type = TokenType::SHIFT_LEFT, .line = line_count });
+            }
             else
                 tokens.push_back({ .type = TokenType::LOWER, .line = line_count });
         }
         else if (peek().value() == '\'') {
             consume(); // '
 
-            if (peek().has_value() && isalnum(peek().value())) {
+            // any printable character but the quote and the backslash, there are no escapes
+            if (peek().has_value() && std::isprint(static_cast<unsigned char>(peek().value())) && peek().value() != '\'' && peek().value() != '\\') {
                 std::string c;
                 c += consume();
                 tokens.push_back({ .type = TokenType::CHAR_LITERAL, .line = line_count, .val = c });
@@ -349,7 +576,6 @@ std::vector<Token> Tokenizer::tokenize() {
             }
 
             consume(); // "
-            line_count++;
         }
         else if (peek().value() == '\n') {
             line_count++;
@@ -8,20 +8,49 @@
 enum TokenType {
     RETURN,
     VAR,
+    CONST,
     FUNC,
+    STRUCT,
+    ENUM,
+    IMPORT,
+    REF,
     IDENTIFIER,
 
     TYPE_BOOL,
     TYPE_INT,
+    TYPE_I8,
+    TYPE_I16,
+    TYPE_I64,
+    TYPE_U8,
+    TYPE_U16,
+    TYPE_U32,
+    TYPE_U64,
     TYPE_CHAR,
     TYPE_STRING,
+    TYPE_FLOAT,
+    TYPE_DOUBLE,
+    TYPE_VEC2,
+    TYPE_VEC3,
+    TYPE_VEC4,
+    TYPE_LIST,
+    TYPE_MAP,
+    TYPE_BYTES,
+    TYPE_STR_VIEW,
 
     BOOLEAN_LITEARL,
     INTEGER_LITERAL,
+    FLOAT_LITERAL,
+    DOUBLE_LITERAL,
     CHAR_LITERAL,
     STRING_LITERAL,
 
     WHILE,
+    FOR,
+    IN,
+    PARALLEL,
+    FRAME,
+    BENCH,
+    MATCH,
     IF,
     ELIF,
     ELSE,
@@ -33,10 +62,25 @@ enum TokenType {
     RIGHT_PARENTHESIS,
     LEFT_CURLY_BACKET,
     RIGHT_CURLY_BRACKET,
+    LEFT_SQUARE_BRACKET,
+    RIGHT_SQUARE_BRACKET,
+    DOT,
+    RANGE,
+    RANGE_INCLUSIVE,
+    ARROW,
+    AT,
     PLUS,
     MINUS,
     STAR,
     SLASH,
+    PERCENT,
+
+    BIT_AND,
+    BIT_OR,
+    BIT_XOR,
+    BIT_NOT,
+    SHIFT_LEFT,
+    SHIFT_RIGHT,
 
     INCREMENTATOR,
     DECREMENTATOR,
@@ -57,9 +101,9 @@ enum TokenType {
 /// @return string equivalent to the given token type
 std::string to_string(const TokenType type);
 
-/// @brief calc the operator prec of a token
+/// @brief calc the operator prec of a token, from 0 (||) to 9 (* / %)
 /// @param type
-/// @return an optional value of the operator prec (return nothing if the token is not an operator)
+/// @return an optional value of the operator prec (return nothing if the token is not a binary operator)
 std::optional<int> op_prec(TokenType type);
 
 /// @brief a token is represented by its type, the line it is on and an optional value
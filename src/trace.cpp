@@ -0,0 +1,134 @@
+#include "trace.h"
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+namespace trace {
+    namespace {
+        struct Event {
+            std::string name;
+            int tid;
+            long long start_us;
+            long long dur_us;
+        };
+
+        std::atomic<bool> is_enabled{ false };
+        std::string output_path;
+
+        const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+        std::mutex mutex;
+        std::vector<Event> events;
+        std::vector<std::pair<int, std::string>> thread_names;
+
+        std::atomic<int> thread_count{ 0 };
+
+        int thread_id() {
+            thread_local const int id = ++thread_count;
+            return id;
+        }
+
+        long long since_origin_us(std::chrono::steady_clock::time_point t) {
+            return std::chrono::duration_cast<std::chrono::microseconds>(t - origin).count();
+        }
+
+        // a json string: quotes and backslashes escaped, control characters (a newline in a path) as \u00XX
+        std::string escape(const std::string& s) {
+            std::string res;
+            for (const char c : s) {
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char code[7];
+                    std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(c)));
+                    res += code;
+                    continue;
+                }
+                if (c == '"' || c == '\\')
+                    res += '\\';
+                res += c;
+            }
+            return res;
+        }
+    }
+
+    void enable(const std::string& path) {
+        output_path = path;
+        is_enabled = true;
+        set_thread_name("main");
+    }
+
+    bool enabled() {
+        return is_enabled;
+    }
+
+    void set_thread_name(const std::string& name) {
+        if (!enabled())
+            return;
+
+        std::lock_guard lock(mutex);
+        thread_names.emplace_back(thread_id(), name);
+    }
+
+    bool write() {
+        if (!enabled())
+            return true;
+
+        std::lock_guard lock(mutex);
+
+        std::ofstream out(output_path);
+        if (!out)
+            return false;
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+        bool first = true;
+        for (const auto& [tid, name] : thread_names) {
+            out << (first ? "" : ",\n");
+            out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << tid
+                << ",\"args\":{\"name\":\"" << escape(name) << "\"}}";
+            first = false;
+        }
+
+        for (const Event& e : events) {
+            out << (first ? "" : ",\n");
+            out << "{\"ph\":\"X\",\"cat\":\"cern\",\"name\":\"" << escape(e.name) << "\",\"pid\":1,\"tid\":" << e.tid
+                << ",\"ts\":" << e.start_us << ",\"dur\":" << e.dur_us << "}";
+            first = false;
+        }
+
+        out << "\n]}\n";
+
+        return out.good();
+    }
+
+    Span::Span(std::string_view name, std::string_view detail)
+        : _active(enabled()) {
+        if (!_active)
+            return;
+
+        _name = name;
+        if (!detail.empty()) {
+            _name += " ";
+            _name += detail;
+        }
+
+        _start = std::chrono::steady_clock::now();
+    }
+
+    Span::~Span() {
+        if (!_active)
+            return;
+
+        const auto end = std::chrono::steady_clock::now();
+
+        std::lock_guard lock(mutex);
+        events.push_back({
+            .name = std::move(_name),
+            .tid = thread_id(),
+            .start_us = since_origin_us(_start),
+            .dur_us = since_origin_us(end) - since_origin_us(_start),
+        });
+    }
+}
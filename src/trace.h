@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <chrono>
+
+/// @brief records nested spans of the compiler phases in the chrome trace-event format
+/// (viewable in Perfetto or chrome://tracing)
+namespace trace {
+    /// @brief start recording spans
+    /// @param path file the trace is written to by `write`
+    void enable(const std::string& path);
+
+    /// @return true if spans are being recorded
+    bool enabled();
+
+    /// @brief name the calling thread in the trace (threads are numbered in order of their first span)
+    void set_thread_name(const std::string& name);
+
+    /// @brief write every recorded span to the file given to `enable`
+    /// @return false if the file could not be written
+    bool write();
+
+    /// @brief records the time between its construction and its destruction on the calling thread
+    class Span {
+    private:
+        std::string _name;
+        std::chrono::steady_clock::time_point _start;
+        bool _active;
+
+    public:
+        /// @param name name of the span (ex: tokenize, parse)
+        /// @param detail appended to the name (ex: the function being generated)
+        Span(std::string_view name, std::string_view detail = {});
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        ~Span();
+    };
+}
@@ -0,0 +1,535 @@
+// cern-gen: emits random but well-typed Cern programs (see docs/grammar.md)
+// used to feed scaling and stress tests of the compiler.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <optional>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+
+namespace {
+    struct Options {
+        uint64_t seed = 1;
+        // number of functions besides main
+        int funcs = 8;
+        // number of statements in each function body
+        int stmts = 16;
+        // max nesting depth of if / while / scopes
+        int depth = 3;
+        // max number of binary operators in an expression
+        int expr_len = 4;
+        // number of global variables declared for each type
+        int idents = 4;
+        std::string out;
+    };
+
+    enum Type {
+        BOOL,
+        INT,
+        CHAR,
+        STRING
+    };
+
+    constexpr std::array<Type, 4> all_types = { Type::BOOL, Type::INT, Type::CHAR, Type::STRING };
+
+    std::string to_string(Type t)
+    {
+        switch (t)
+        {
+        case Type::BOOL:
+            return "bool";
+        case Type::INT:
+            return "int";
+        case Type::CHAR:
+            return "char";
+        default:
+            return "string";
+        }
+    }
+
+    struct Var {
+        std::string name;
+        Type type;
+        // loop variables and constants can be read but not assigned
+        bool readonly = false;
+    };
+
+    class Generator {
+    private:
+        const Options opt;
+        std::mt19937_64 rng;
+        std::stringstream out;
+
+        std::string indentation;
+
+        // every variable visible from the current point, innermost last
+        std::vector<Var> vars;
+        // number of visible variables when each scope was opened
+        std::vector<size_t> scopes;
+
+        // functions declared so far (all of them return an int)
+        std::vector<std::string> funcs;
+        // locals cannot shadow a global or an enclosing local, so every local gets a fresh name
+        int local_count = 0;
+        // a function makes at most one call so that the call graph stays linear
+        bool call_used = false;
+
+        int rand(int lo, int hi)
+        {
+            return std::uniform_int_distribution<int>(lo, hi)(rng);
+        }
+
+        bool chance(int percent)
+        {
+            return rand(0, 99) < percent;
+        }
+
+        Type rand_type()
+        {
+            return all_types[rand(0, all_types.size() - 1)];
+        }
+
+        std::string fresh_local()
+        {
+            return "l" + std::to_string(local_count++);
+        }
+
+        std::optional<Var> pick_var(Type t, bool to_write = false)
+        {
+            std::vector<const Var*> candidates;
+            for (const Var& v : vars)
+                if (v.type == t && !(to_write && v.readonly))
+                    candidates.push_back(&v);
+
+            if (candidates.empty())
+                return {};
+            return *candidates[rand(0, candidates.size() - 1)];
+        }
+
+        void open_scope()
+        {
+            out << indentation << "{\n";
+            indentation += "    ";
+            scopes.push_back(vars.size());
+        }
+
+        void close_scope()
+        {
+            vars.resize(scopes.back());
+            scopes.pop_back();
+            indentation.resize(indentation.size() - 4);
+            out << indentation << "}\n";
+        }
+
+        std::string literal(Type t)
+        {
+            static const std::string alnum = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+            switch (t)
+            {
+            case Type::BOOL:
+                return chance(50) ? "true" : "false";
+            case Type::INT:
+                return std::to_string(rand(0, 100));
+            case Type::CHAR:
+                return std::string("'") + alnum[rand(0, alnum.size() - 1)] + "'";
+            default:
+            {
+                std::string s = "\"";
+                const int len = rand(1, 12);
+                for (int i = 0; i < len; i++)
+                    s += chance(15) ? ' ' : alnum[rand(0, alnum.size() - 1)];
+                return s + "\"";
+            }
+            }
+        }
+
+        // a leaf of the expression tree: literal, variable, builtin or function call
+        std::string leaf(Type t)
+        {
+            const int r = rand(0, 99);
+
+            if (r < 40)
+                if (const auto v = pick_var(t))
+                    return v->name;
+
+            if (t == Type::INT && r >= 90 && !funcs.empty() && !call_used)
+            {
+                call_used = true;
+                return funcs[rand(0, funcs.size() - 1)] + "()";
+            }
+
+            if (t == Type::INT && r >= 80)
+                return "ctoi(" + leaf(Type::CHAR) + ")";
+
+            if (t == Type::CHAR && r >= 80)
+                return "itoc(" + leaf(Type::INT) + ")";
+
+            return literal(t);
+        }
+
+        // every binary operation is parenthesized so the result does not depend on operator precedence
+        std::string expr(Type t, int ops)
+        {
+            if (ops <= 0)
+                return leaf(t);
+
+            const int lops = rand(0, ops - 1);
+            const int rops = ops - 1 - lops;
+
+            switch (t)
+            {
+            case Type::INT:
+            {
+                switch (rand(0, 3))
+                {
+                case 0:
+                    return "(" + expr(t, lops) + " + " + expr(t, rops) + ")";
+                case 1:
+                    return "(" + expr(t, lops) + " - " + expr(t, rops) + ")";
+                case 2:
+                    return "(" + expr(t, lops) + " * " + expr(t, rops) + ")";
+                default:
+                    // never divide by something that could be zero
+                    return "(" + expr(t, ops - 1) + " / " + std::to_string(rand(1, 9)) + ")";
+                }
+            }
+            case Type::BOOL:
+            {
+                switch (rand(0, 3))
+                {
+                case 0:
+                    return "(" + expr(t, lops) + " && " + expr(t, rops) + ")";
+                case 1:
+                    return "(" + expr(t, lops) + " || " + expr(t, rops) + ")";
+                case 2:
+                    return "(!" + expr(t, ops - 1) + ")";
+                default:
+                {
+                    static const std::array<std::string, 6> cmp = { "==", "!=", "<", "<=", ">", ">=" };
+                    const Type operand = chance(70) ? Type::INT : Type::CHAR;
+                    return "(" + expr(operand, lops) + " " + cmp[rand(0, cmp.size() - 1)] + " " + expr(operand, rops) + ")";
+                }
+                }
+            }
+            default:
+                // chars and strings have no operator returning the same type
+                return leaf(t);
+            }
+        }
+
+        std::string rand_expr(Type t)
+        {
+            return expr(t, rand(0, opt.expr_len));
+        }
+
+        void var_declaration()
+        {
+            const Type t = rand_type();
+            const std::string name = fresh_local();
+
+            out << indentation << "var " << name;
+            if (chance(50))
+                out << " : " << to_string(t);
+            out << " = " << rand_expr(t) << "\n";
+
+            vars.push_back({ name, t });
+        }
+
+        void assignment()
+        {
+            const Type t = rand_type();
+
+            if (const auto v = pick_var(t, true))
+                out << indentation << v->name << " = " << rand_expr(t) << "\n";
+            else
+                var_declaration();
+        }
+
+        void print()
+        {
+            out << indentation << (chance(50) ? "println(" : "print(");
+
+            const int argc = rand(1, 3);
+            for (int i = 0; i < argc; i++)
+            {
+                if (i > 0)
+                    out << ", ";
+                out << rand_expr(rand_type());
+            }
+
+            out << ")\n";
+        }
+
+        void if_statement(int depth)
+        {
+            out << indentation << "if (" << rand_expr(Type::BOOL) << ")\n";
+            block(depth + 1);
+
+            while (chance(30))
+            {
+                out << indentation << "elif (" << rand_expr(Type::BOOL) << ")\n";
+                block(depth + 1);
+            }
+
+            if (chance(50))
+            {
+                out << indentation << "else\n";
+                block(depth + 1);
+            }
+        }
+
+        // counted loops only, so the generated programs always terminate
+        void while_statement(int depth)
+        {
+            const std::string counter = fresh_local();
+
+            out << indentation << "var " << counter << " = 0\n";
+            out << indentation << "while (" << counter << " < " << rand(1, 4) << ")\n";
+
+            open_scope();
+            const int n = rand(1, std::max(1, opt.stmts / 4));
+            for (int i = 0; i < n; i++)
+                statement(depth + 1);
+            out << indentation << counter << "++\n";
+            close_scope();
+        }
+
+        void for_statement(int depth)
+        {
+            const std::string counter = fresh_local();
+
+            out << indentation << "for " << counter << " in 0.." << rand(1, 6);
+            if (chance(30))
+                out << " step " << rand(1, 3);
+            out << "\n";
+
+            open_scope();
+            vars.push_back({ counter, Type::INT, true });
+            const int n = rand(1, std::max(1, opt.stmts / 4));
+            for (int i = 0; i < n; i++)
+                statement(depth + 1);
+            close_scope();
+        }
+
+        void match_statement(int depth)
+        {
+            out << indentation << "match (" << rand_expr(Type::INT) << ") {\n";
+            indentation += "    ";
+
+            int next = 0;
+            const int arms = rand(1, 3);
+            for (int i = 0; i < arms; i++)
+            {
+                const int first = next + rand(0, 2);
+                const int last = first + rand(0, 3);
+                next = last + 1;
+
+                out << indentation << first;
+                if (last != first)
+                    out << "..=" << last;
+                out << " =>\n";
+                block(depth + 1);
+            }
+
+            out << indentation << "else =>\n";
+            block(depth + 1);
+
+            indentation.resize(indentation.size() - 4);
+            out << indentation << "}\n";
+        }
+
+        void block(int depth)
+        {
+            open_scope();
+            const int n = rand(1, std::max(1, opt.stmts / 4));
+            for (int i = 0; i < n; i++)
+                statement(depth);
+            close_scope();
+        }
+
+        void statement(int depth)
+        {
+            const int r = rand(0, 99);
+            const bool can_nest = depth < opt.depth;
+
+            if (r < 25)
+                var_declaration();
+            else if (r < 50)
+                assignment();
+            else if (r < 65)
+                print();
+            else if (r < 78 && can_nest)
+                if_statement(depth);
+            else if (r < 83 && can_nest)
+                while_statement(depth);
+            else if (r < 86 && can_nest)
+                for_statement(depth);
+            else if (r < 88 && can_nest)
+                match_statement(depth);
+            else if (r < 93 && can_nest)
+                block(depth + 1);
+            else
+                assignment();
+        }
+
+        void globals()
+        {
+            for (const Type t : all_types)
+            {
+                for (int i = 0; i < opt.idents; i++)
+                {
+                    const std::string name = "g_" + to_string(t) + std::to_string(i);
+                    out << "var " << name << " : " << to_string(t) << " = " << literal(t) << "\n";
+                    vars.push_back({ name, t });
+                }
+
+                // strings cannot be constants
+                if (t != Type::STRING)
+                {
+                    const std::string name = "k_" + to_string(t);
+                    out << "const " << name << " = " << literal(t) << "\n";
+                    vars.push_back({ name, t, true });
+                }
+            }
+        }
+
+        void function(const std::string& name, int stmts)
+        {
+            call_used = false;
+
+            out << "\nfunc " << name << "() : int\n";
+            open_scope();
+            for (int i = 0; i < stmts; i++)
+                statement(1);
+            out << indentation << "return " << rand_expr(Type::INT) << "\n";
+            close_scope();
+        }
+
+    public:
+        Generator(const Options& opt)
+            : opt(opt), rng(opt.seed)
+        {
+        }
+
+        std::string program()
+        {
+            out << "// generated by cern-gen --seed " << opt.seed
+                << " --funcs " << opt.funcs
+                << " --stmts " << opt.stmts
+                << " --depth " << opt.depth
+                << " --expr " << opt.expr_len
+                << " --idents " << opt.idents << "\n\n";
+
+            globals();
+
+            for (int i = 0; i < opt.funcs; i++)
+            {
+                const std::string name = "f" + std::to_string(i);
+                function(name, opt.stmts);
+                funcs.push_back(name);
+            }
+
+            // main runs the last few functions so that the program does something
+            call_used = true;
+            out << "\nfunc main() : int\n";
+            open_scope();
+            for (int i = std::max(0, opt.funcs - 8); i < opt.funcs; i++)
+                out << indentation << "println(" << funcs[i] << "())\n";
+            out << indentation << "return 0\n";
+            close_scope();
+
+            return out.str();
+        }
+    };
+
+    void usage()
+    {
+        std::cerr << "usage: cern-gen [options]\n"
+                  << "  --seed <n>     random seed (default 1)\n"
+                  << "  --funcs <n>    number of functions besides main (default 8)\n"
+                  << "  --stmts <n>    statements per function body (default 16)\n"
+                  << "  --depth <n>    max nesting depth (default 3)\n"
+                  << "  --expr <n>     max binary operators per expression (default 4)\n"
+                  << "  --idents <n>   global variables per type (default 4)\n"
+                  << "  -o <file>      output file (default stdout)" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+
+        if (arg == "-h" || arg == "--help")
+        {
+            usage();
+            return EXIT_SUCCESS;
+        }
+
+        if (i + 1 >= argc)
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+
+        const std::string val = argv[++i];
+
+        try
+        {
+            if (arg == "--seed")
+                opt.seed = std::stoull(val);
+            else if (arg == "--funcs")
+                opt.funcs = std::stoi(val);
+            else if (arg == "--stmts")
+                opt.stmts = std::stoi(val);
+            else if (arg == "--depth")
+                opt.depth = std::stoi(val);
+            else if (arg == "--expr")
+                opt.expr_len = std::stoi(val);
+            else if (arg == "--idents")
+                opt.idents = std::stoi(val);
+            else if (arg == "-o")
+                opt.out = val;
+            else
+            {
+                usage();
+                return EXIT_FAILURE;
+            }
+        }
+        catch (const std::exception&)
+        {
+            std::cerr << "invalid value `" << val << "` for " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (opt.funcs < 0 || opt.stmts < 0 || opt.depth < 0 || opt.expr_len < 0 || opt.idents < 1)
+    {
+        std::cerr << "counts must be positive (--idents at least 1)" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Generator generator(opt);
+    const std::string program = generator.program();
+
+    if (opt.out.empty())
+    {
+        std::cout << program;
+    }
+    else
+    {
+        std::ofstream outfile(opt.out);
+        outfile << program;
+    }
+
+    return EXIT_SUCCESS;
+}